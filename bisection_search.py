@@ -3,6 +3,7 @@
 import subprocess
 import sys
 import os
+import fcntl
 from pathlib import Path
 from datetime import datetime
 from run_mosek import solve as mosek_solve
@@ -30,6 +31,12 @@ MAX_ITERATIONS = 100
 
 # Path to executable
 EXECUTABLE_PATH = './implicit_learning'
+# Exit status of the C++ program when presolve proves the probe infeasible (PRESOLVE_INFEASIBLE in conversion.h)
+PRESOLVE_INFEASIBLE_EXIT = 3
+# The C++ program reports the SDP it wrote (path relative to its cwd, build/);
+# the file name follows param.sdpFormat: .dat-s (text), .sdpb (binary) or .cbf
+SDP_OUTPUT_MARKER = 'Writing SDP to: '
+SDP_OUTPUTS = [Path('./data/sparsepop_output_test' + ext) for ext in ('.dat-s', '.sdpb', '.cbf')]
 #############################################
 
 def load_job_config(job_number, tsv_file='./data/jobArray_function.tsv'):
@@ -58,6 +65,31 @@ def load_job_config(job_number, tsv_file='./data/jobArray_function.tsv'):
 
 LOG_FILE = None  # Will be set in main() based on job number
 
+# Feasibility cache for the components that do not contain the bounded atom
+# (read by conversion_part2, written only here). A probe that emitted its full
+# system prints the signature of its residual components after this marker; the
+# signature covers the residual constraints and the SDP-shaping parameters.
+# Residuals are never solved on their own: entries come only from feasible
+# full-system solves.
+COMPONENT_CACHE_FILE = Path('./data/sparsepop_components.cache')
+PENDING_RESIDUAL_MARKER = '[CC] Pending residual: '
+
+def mark_component_feasible(signature):
+    # A feasible full SDP implies each of its independent components is feasible,
+    # so the residual signature of that probe (and no other) becomes feasible.
+    # Concurrent jobs serialize on the lock file; the cache is replaced
+    # atomically so the C++ reader never sees a partial file.
+    lock_path = COMPONENT_CACHE_FILE.with_name(COMPONENT_CACHE_FILE.name + '.lock')
+    with open(lock_path, 'w') as lock:
+        fcntl.flock(lock, fcntl.LOCK_EX)
+        lines = COMPONENT_CACHE_FILE.read_text().split('\n') if COMPONENT_CACHE_FILE.exists() else []
+        lines = [l for l in lines if l.strip() and l.split()[0] != signature]
+        lines.append(f"{signature} feasible")
+        tmp = COMPONENT_CACHE_FILE.with_name(f"{COMPONENT_CACHE_FILE.name}.{os.getpid()}.tmp")
+        tmp.write_text('\n'.join(lines) + '\n')
+        os.replace(tmp, COMPONENT_CACHE_FILE)
+    log_print(f"  Cached residual component {signature} as feasible")
+
 # print to both console and log file
 def log_print(message="", end="\n"):
     print(message, end=end)
@@ -93,6 +125,9 @@ class BisectionSearch:
         self.data_file = data_file
         self.executable_path = executable_path
         self.log_file = f"bisection_search_job{job_number}.log"  # Job-specific log
+        self.presolve_infeasible = False  # set by run_cpp_program when no SDP was written
+        self.output_file = None  # SDP written by the last run_cpp_program
+        self.pending_residual = None  # residual signature printed by the last run_cpp_program
         
     # Run with a specified bound
     def run_cpp_program(self, bound_value):
@@ -107,13 +142,38 @@ class BisectionSearch:
         ]
         
         log_print(f"  Running: {' '.join(cmd)}")
+        self.presolve_infeasible = False
+        self.output_file = None
+        self.pending_residual = None
+        # never solve the SDP of an earlier probe
+        for stale in SDP_OUTPUTS:
+            if stale.exists():
+                stale.unlink()
         
         try:
             result = subprocess.run(cmd, capture_output=True, text=True, timeout=1800, cwd='build')
+            if result.returncode == PRESOLVE_INFEASIBLE_EXIT:
+                log_print(f"  Presolve proved the probe infeasible, skipping the SDP solve")
+                self.presolve_infeasible = True
+                return True
             if result.returncode != 0:
                 log_print(f"  ERROR: C++ program failed with exit code {result.returncode}")
                 log_print(f"  stderr: {result.stderr}")
                 return False
+            for line in result.stdout.splitlines():
+                if line.startswith(SDP_OUTPUT_MARKER):
+                    self.output_file = Path(os.path.normpath(Path('build') / line[len(SDP_OUTPUT_MARKER):].strip()))
+                elif line.startswith(PENDING_RESIDUAL_MARKER):
+                    self.pending_residual = line[len(PENDING_RESIDUAL_MARKER):].strip()
+            if self.output_file is None:
+                log_print(f"  ERROR: C++ program did not report its SDP file")
+                return False
+            if self.output_file.suffix == '.cbf':
+                log_print(f"  ERROR: sdpFormat = cbf is export-only; use text or binary for the search")
+                return False
+            if SOLVER != 'MOSEK' and self.output_file.suffix != '.dat-s':
+                log_print(f"  ERROR: cuLoRADS reads SDPA text only; use sdpFormat = text")
+                return False
             return True
         except subprocess.TimeoutExpired:
             log_print(f"  ERROR: C++ program timed out after 1800 seconds")
@@ -183,9 +243,9 @@ class BisectionSearch:
     #         return False
     
     def check_feasibility(self, solver_timeout=3600):
-        output_file = Path('./data/sparsepop_output_test.dat-s')
+        output_file = self.output_file
 
-        if not output_file.exists():
+        if output_file is None or not output_file.exists():
             log_print(f"  Output file not found: {output_file}")
             return False
 
@@ -193,9 +253,12 @@ class BisectionSearch:
         log_print(f"  Found output file: {output_file} ({file_size} bytes)")
 
         if SOLVER == 'MOSEK':
-            return self._check_feasibility_mosek(output_file)
+            is_feasible = self._check_feasibility_mosek(output_file)
         else:
-            return self._check_feasibility_culorads(output_file, solver_timeout)
+            is_feasible = self._check_feasibility_culorads(output_file, solver_timeout)
+        if is_feasible and self.pending_residual:
+            mark_component_feasible(self.pending_residual)
+        return is_feasible
 
     def _check_feasibility_mosek(self, output_file):
         log_print(f"  Running MOSEK ...")
@@ -276,7 +339,7 @@ class BisectionSearch:
             # Check if solution is feasible
 
             log_print(f" Started Feasibility: {time.perf_counter () - start_time}")
-            is_feasible = self.check_feasibility()
+            is_feasible = False if self.presolve_infeasible else self.check_feasibility()
             
             # Update bounds based on feasibility
             if self.bound_type == 'upper':
@@ -5,6 +5,7 @@
 #include <iostream>
 #include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace metrics {
@@ -18,6 +19,25 @@ std::size_t peak_rss_bytes();
 // human readable byte string
 std::string human_bytes(std::size_t b);
 
+// Monotonic wall-clock seconds (steady_clock); only differences are meaningful
+double wall_seconds();
+
+// One named stage of the SDP conversion: its duration and the resident set
+// size at its start and end (bytes; 0 when not sampled)
+struct StageRecord {
+    std::string name;
+    double seconds;
+    std::size_t rss_start;
+    std::size_t rss_end;
+    std::size_t peak_end;   // peak RSS reached by the end of the stage
+};
+
+// Named stages, recorded in order by the SDP conversion
+void record_stage(const std::string& name, double seconds,
+                  std::size_t rss_start = 0, std::size_t rss_end = 0, std::size_t peak_end = 0);
+const std::vector<StageRecord>& stage_times();
+void print_stages(std::ostream& os = std::cout);
+
 class Checkpoint {
 public:
     explicit Checkpoint(std::string label = "start");
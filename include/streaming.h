@@ -3,43 +3,450 @@
 
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <cstdio>
+#include <cstring>
 #include <functional>
 #include <string>
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 // Forward declarations
 class spvec_array;
 class poly_info;
+class VarFlags;
 
-// MonomialKey: Represents a monomial for hashing (sparse: var_index -> exponent)
+// splitmix64 step folding one (var, exp) term into a monomial hash
+inline size_t mix_monomial_hash(size_t h, int var, int exp) {
+    uint64_t x = (uint64_t)h ^ (((uint64_t)(uint32_t)var << 32) | (uint32_t)exp);
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return (size_t)(x ^ (x >> 31));
+}
+
+// MonomialKey: Represents a monomial for hashing (sparse: var_index -> exponent).
+// Terms are (var, exp) pairs interleaved in an int array, sorted by index; up to
+// INLINE terms are kept inline and larger keys spill into a vector. The hash is
+// folded in term by term as push_back builds the key, so it is computed once.
 struct MonomialKey {
-    std::vector<std::pair<int, int>> terms;  // (variable_index, exponent) pairs, sorted by index
+    static const int INLINE = 8;
+    int size = 0;
+    size_t hash = 0;
+    int inl[2 * INLINE];
+    std::vector<int> heap;
+
     MonomialKey() = default;
-    
+    MonomialKey(std::initializer_list<std::pair<int, int>> terms) {
+        for (const auto& t : terms) push_back(t.first, t.second);
+    }
     // Construct from spvec_array at a specific monomial position
     MonomialKey(const spvec_array& sups, int monomial_idx);
+
+    const int* data() const { return size <= INLINE ? inl : heap.data(); }
+    int var(int t) const { return data()[2 * t]; }
+    int exp(int t) const { return data()[2 * t + 1]; }
+    void push_back(int v, int e) {
+        if (size < INLINE) {
+            inl[2 * size] = v;
+            inl[2 * size + 1] = e;
+        } else {
+            if (size == INLINE) heap.assign(inl, inl + 2 * INLINE);
+            heap.push_back(v);
+            heap.push_back(e);
+        }
+        size++;
+        hash = mix_monomial_hash(hash, v, e);
+    }
+    // packed form stored by FlatMonomialMap
+    const int* packed() const { return data(); }
+    int packed_size() const { return 2 * size; }
+    static MonomialKey from_packed(const int* p, int n) {
+        MonomialKey key;
+        for (int t = 0; t < n; t += 2) key.push_back(p[t], p[t + 1]);
+        return key;
+    }
     bool operator==(const MonomialKey& other) const {
-        return terms == other.terms;
+        return hash == other.hash && size == other.size
+            && std::equal(data(), data() + 2 * size, other.data());
     }
 };
 
-// Hash function for MonomialKey
+// Hash function for MonomialKey (cached while the key is built)
 struct MonomialKeyHash {
     size_t operator()(const MonomialKey& key) const {
-        size_t h = 0;
-        for (const auto& [var, exp] : key.terms) {
-            // Combine hashes: var and exponent
-            h ^= std::hash<int>()(var) + 0x9e3779b9 + (h << 6) + (h >> 2);
-            h ^= std::hash<int>()(exp) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        return key.hash;
+    }
+};
+
+// MultilinearKey: Monomial of an all-binary problem. Since x^2 = x for every
+// variable, a monomial is just its sorted set of variable indices; sets of up to
+// INLINE variables are kept inline, larger ones spill into a vector.
+struct MultilinearKey {
+    static const int INLINE = 8;
+    int size = 0;
+    int inl[INLINE];
+    std::vector<int> heap;
+
+    const int* data() const { return size <= INLINE ? inl : heap.data(); }
+    const int* packed() const { return data(); }
+    int packed_size() const { return size; }
+    static MultilinearKey from_packed(const int* p, int n) {
+        MultilinearKey key;
+        for (int t = 0; t < n; t++) key.push_back(p[t]);
+        return key;
+    }
+    void push_back(int v) {
+        if (size < INLINE) { inl[size++] = v; return; }
+        if (size == INLINE) heap.assign(inl, inl + INLINE);
+        heap.push_back(v);
+        size++;
+    }
+    // sort and drop repeated variables (x*x = x)
+    void sort_unique() {
+        int* d = size <= INLINE ? inl : heap.data();
+        std::sort(d, d + size);
+        int n = (int)(std::unique(d, d + size) - d);
+        if (size > INLINE) {
+            heap.resize(n);
+            if (n <= INLINE) { std::copy(heap.begin(), heap.end(), inl); heap.clear(); }
+        }
+        size = n;
+    }
+    bool operator==(const MultilinearKey& other) const {
+        return size == other.size && std::equal(data(), data() + size, other.data());
+    }
+};
+
+// Hash function for MultilinearKey (splitmix64 finalizer over the indices)
+struct MultilinearKeyHash {
+    size_t operator()(const MultilinearKey& key) const {
+        uint64_t h = 0x9e3779b97f4a7c15ULL + (uint64_t)key.size;
+        const int* d = key.data();
+        for (int i = 0; i < key.size; i++) {
+            h ^= (uint64_t)(uint32_t)d[i];
+            h += 0x9e3779b97f4a7c15ULL;
+            h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+            h ^= h >> 31;
+        }
+        return (size_t)h;
+    }
+};
+
+// One SDPA entry as kept in the single-pass spill file (and in .sdpb files)
+struct SpillRecord {
+    int var_num;
+    int block;
+    int row;
+    int col;
+    double coef;
+};
+
+// Identity of a block for duplicate elimination: its size, entry count and two
+// independent 64-bit hashes of its canonical (var, row, col, coef) list
+struct BlockKey {
+    int size;
+    int64_t nnz;
+    uint64_t h1;
+    uint64_t h2;
+    bool operator==(const BlockKey& other) const {
+        return size == other.size && nnz == other.nnz && h1 == other.h1 && h2 == other.h2;
+    }
+};
+
+struct BlockKeyHash {
+    size_t operator()(const BlockKey& k) const { return (size_t)k.h1; }
+};
+
+// Binary SDP container (.sdpb). Little-endian; every array is 8-byte aligned so
+// numpy can memory-map it directly:
+//   [0, 64)         SdpbHeader
+//   blocks_offset   int32   block_struct[nBlocks]   (negative: diagonal/LP block)
+//   obj_offset      float64 obj[mDim]
+//   entries_offset  nnz records {int32 var, block, row, col; float64 coef},
+//                   sorted by block; var 0 is the constant matrix F0
+//   ptr_offset      int64   block_ptr[nBlocks + 1]: block b (1-based) holds
+//                   entries [block_ptr[b-1], block_ptr[b])
+const char SDPB_MAGIC[8] = {'S', 'P', 'O', 'P', 'S', 'D', 'P', 'B'};
+const uint32_t SDPB_VERSION = 1;
+
+struct SdpbHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_bytes;
+    int32_t mDim;          // number of SDPA variables y_1..y_mDim
+    int32_t nBlocks;
+    int64_t nnz;
+    int64_t blocks_offset;
+    int64_t obj_offset;
+    int64_t entries_offset;
+    int64_t ptr_offset;
+};
+static_assert(sizeof(SdpbHeader) == 64, "SdpbHeader must be 64 bytes");
+static_assert(sizeof(SpillRecord) == 24, "SpillRecord must be 24 bytes");
+
+// Read-only, memory-mapped view of an .sdpb file
+class SdpbView {
+public:
+    SdpbView() = default;
+    ~SdpbView() { close(); }
+    SdpbView(const SdpbView&) = delete;
+    SdpbView& operator=(const SdpbView&) = delete;
+
+    // map path and check the header and the section bounds; false (with a
+    // message) if the file is not a readable .sdpb container
+    bool open(const std::string& path);
+    void close();
+
+    const SdpbHeader& header() const { return *(const SdpbHeader*)base; }
+    const int32_t* block_struct() const { return (const int32_t*)(base + header().blocks_offset); }
+    const double* obj() const { return (const double*)(base + header().obj_offset); }
+    const SpillRecord* entries() const { return (const SpillRecord*)(base + header().entries_offset); }
+    const int64_t* block_ptr() const { return (const int64_t*)(base + header().ptr_offset); }
+
+    // check every entry: block order, variable and row/col ranges, finite values
+    bool validate() const;
+
+private:
+    const char* base = nullptr;
+    size_t length = 0;
+};
+
+// Open, validate and summarize an .sdpb file; true when it is valid
+bool check_sdpb_file(const std::string& path);
+
+// Output format of stream_psdp_to_file
+enum SdpFormat {
+    SDP_TEXT,     // SDPA sparse format (.dat-s)
+    SDP_BINARY,   // .sdpb container
+    SDP_CBF       // CBF conic file with native equality rows
+};
+
+// Check that a CBF file written by stream_psdp_to_file and an SDPA encoding of
+// the same problem (.dat-s text or .sdpb) describe the same feasible set: equal
+// objective and PSD blocks, and the same linear rows once every CBF equality
+// row a.y = b is expanded into the SDPA pair a.y >= b, -a.y >= -b
+bool check_cbf_equivalence(const std::string& cbffile, const std::string& reference);
+
+// FlatMonomialMap: open-addressing map from monomial keys to variable numbers.
+// Keys are not stored as objects: their packed ints go to one arena, and the
+// table holds only entry ids, probed linearly with the low 32 bits of the
+// cached hashes compared first. Entries are never erased.
+template <class Key, class Hash>
+class FlatMonomialMap {
+public:
+    // value stored for key, or -1 when absent
+    int find(const Key& key) const {
+        if (slots.empty()) return -1;
+        uint32_t h = (uint32_t)Hash()(key);
+        size_t mask = slots.size() - 1;
+        for (size_t s = h & mask; ; s = (s + 1) & mask) {
+            int id = slots[s];
+            if (id < 0) return -1;
+            if (same(id, h, key)) return values[id];
+        }
+    }
+    // value stored for key; when absent, key is inserted with value
+    int find_or_insert(const Key& key, int value) {
+        if ((ids() + 1) * 10 > slots.size() * 7) grow();
+        uint32_t h = (uint32_t)Hash()(key);
+        size_t mask = slots.size() - 1;
+        size_t s = h & mask;
+        for (; slots[s] >= 0; s = (s + 1) & mask) {
+            if (same(slots[s], h, key)) return values[slots[s]];
+        }
+        slots[s] = (int)ids();
+        hashes.push_back(h);
+        values.push_back(value);
+        arena.insert(arena.end(), key.packed(), key.packed() + key.packed_size());
+        offsets.push_back(arena.size());
+        return value;
+    }
+    size_t size() const { return values.size(); }
+    // f(packed, packed_size) for every key, in insertion order
+    template <class F>
+    void for_each_key(F f) const {
+        for (size_t id = 0; id < ids(); id++) {
+            f(arena.data() + offsets[id], (int)(offsets[id + 1] - offsets[id]));
+        }
+    }
+    // heap bytes held by the table, the per-entry arrays and the key arena
+    size_t memory_bytes() const {
+        return slots.capacity() * sizeof(int) + hashes.capacity() * sizeof(uint32_t)
+            + values.capacity() * sizeof(int) + offsets.capacity() * sizeof(size_t)
+            + arena.capacity() * sizeof(int);
+    }
+    // drop every entry and release the memory
+    void clear() {
+        std::vector<int>().swap(slots);
+        std::vector<uint32_t>().swap(hashes);
+        std::vector<int>().swap(values);
+        std::vector<size_t>(1, 0).swap(offsets);
+        std::vector<int>().swap(arena);
+    }
+
+private:
+    std::vector<int> slots;         // entry id, -1 when empty; size is a power of two
+    std::vector<uint32_t> hashes;   // per entry (low 32 bits)
+    std::vector<int> values;        // per entry
+    std::vector<size_t> offsets{0}; // entry id's packed key is arena[offsets[id], offsets[id+1])
+    std::vector<int> arena;
+
+    size_t ids() const { return values.size(); }
+    bool same(int id, uint32_t h, const Key& key) const {
+        if (hashes[id] != h) return false;
+        size_t b = offsets[id];
+        size_t n = offsets[id + 1] - b;
+        return n == (size_t)key.packed_size() && std::equal(key.packed(), key.packed() + n, arena.begin() + b);
+    }
+    // double the table (load factor kept below 0.7) and reinsert the ids by cached hash
+    void grow() {
+        size_t cap = slots.empty() ? 1024 : 2 * slots.size();
+        slots.assign(cap, -1);
+        size_t mask = cap - 1;
+        for (size_t id = 0; id < ids(); id++) {
+            size_t s = hashes[id] & mask;
+            while (slots[s] >= 0) s = (s + 1) & mask;
+            slots[s] = (int)id;
         }
-        return h;
     }
 };
 
+// OutOfCoreIndex: monomial numbering for problems whose monomials do not fit
+// in memory. In pass 1 the monomial map is spilled whenever it outgrows the
+// budget, as a run of its keys sorted by (64-bit hash, packed key), each with
+// the ordinal of its insertion (counted over all spills). merge() k-way merges
+// the runs into an index file of fixed-size pages, keeping the smallest ordinal
+// of a key spilled more than once, and numbers the distinct keys 1, 2, ... by
+// that ordinal: the order in which pass 1 first met them, as the in-memory map
+// does. Only the first hash of every page stays in memory; find() reads the
+// candidate pages back with pread.
+class OutOfCoreIndex {
+public:
+    static const size_t PAGE = (size_t)1 << 16;
+
+    OutOfCoreIndex() = default;
+    ~OutOfCoreIndex() { close(); }
+    OutOfCoreIndex(const OutOfCoreIndex&) = delete;
+    OutOfCoreIndex& operator=(const OutOfCoreIndex&) = delete;
+
+    // create prefix.runs and prefix.index; false (with a message) on failure
+    bool open(const std::string& prefix);
+    // close and remove the files (merge already removes the runs)
+    void close();
+    bool is_open() const { return index_file != nullptr; }
+
+    // write the keys of a FlatMonomialMap as one sorted run
+    template <class Map>
+    void spill(const Map& map) {
+        map.for_each_key([this](const int* p, int n) {
+            run_keys.push_back(RunKey{key_hash(p, n), spilled++, p, n});
+        });
+        write_run();
+    }
+    // merge the runs with read buffers totalling about budget bytes and number
+    // the keys (one bit per spilled key is held meanwhile); returns the number
+    // of distinct keys
+    int merge(size_t budget);
+    // number of the packed key, -1 if it was never spilled
+    int find(const int* p, int n);
+
+    int runs() const { return (int)run_begin.size() - 1; }
+    int64_t index_bytes() const { return (int64_t)page_first.size() * (int64_t)PAGE; }
+    static uint64_t key_hash(const int* p, int n);
+
+private:
+    struct RunKey {
+        uint64_t hash;
+        int64_t ord;
+        const int* p;
+        int n;
+    };
+    std::string run_path, index_path;
+    FILE* run_file = nullptr;
+    FILE* index_file = nullptr;
+    std::vector<RunKey> run_keys;
+    int64_t spilled = 0;                 // keys written to runs so far (next ordinal)
+    size_t max_record = 0;               // longest run record, in bytes
+    std::vector<int64_t> run_begin{0};   // run r is [run_begin[r], run_begin[r + 1])
+    std::vector<uint64_t> page_first;    // hash of the first record of every page
+    std::vector<char> page;              // last page read by find
+    int64_t page_loaded = -1;
+
+    void write_run();
+    // replace the ordinals of the index records by their ranks
+    void number_by_ordinal();
+    // f(record) for every index record of the page at p
+    template <class F>
+    static void for_each_record(char* p, F f);
+};
+
+// Double-buffered text output for the SDPA file: entries are formatted with
+// std::to_chars into the front buffer, and a full buffer is handed to a writer
+// thread that fwrites it while the next one fills.
+class SdpaWriter {
+public:
+    static const size_t ENTRY_MAX = 512;   // upper bound on one formatted line
+
+    explicit SdpaWriter(size_t capacity = (size_t)1 << 22) : capacity(capacity) {}
+    ~SdpaWriter() { detach(); }
+    SdpaWriter(const SdpaWriter&) = delete;
+    SdpaWriter& operator=(const SdpaWriter&) = delete;
+
+    // start the writer thread on file / flush, stop the thread (file stays open)
+    void attach(FILE* file);
+    void detach();
+    bool attached() const { return file != nullptr; }
+
+    // "var block row col value" as printf("%d %d %d %d %15.10f\n")
+    void put_entry(int var_num, int block, int row, int col, double coef);
+    // value as printf("%.15e ")
+    void put_sci(double value);
+    // value as printf("%d")
+    void put_int(int value);
+    // shortest text that reads back as value
+    void put_double(double value);
+    void put_int64(int64_t value);
+    void put(const char* text, size_t n);
+    void put(const std::string& text) { put(text.data(), text.size()); }
+    void put(const char* text) { put(text, strlen(text)); }
+
+    // "var block row col value\n" at p; returns the end of the line
+    static char* format_entry(char* p, int var_num, int block, int row, int col, double coef);
+
+private:
+    size_t capacity;
+    FILE* file = nullptr;
+    std::vector<char> front, back;
+    size_t used = 0;      // bytes filled in front
+    size_t pending = 0;   // bytes of back not yet written (0: writer idle)
+    bool stop = false;
+    bool failed = false;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    // room for n more bytes in front
+    char* reserve(size_t n) {
+        if (used + n > front.size()) hand_off();
+        return front.data() + used;
+    }
+    void hand_off();
+    void run();
+};
+
 // StreamingContext: Shared state for both passes
 struct StreamingContext {
     // Monomial -> variable number mapping (built in pass 1, used in pass 2)
-    std::unordered_map<MonomialKey, int, MonomialKeyHash> monomial_to_var;
+    FlatMonomialMap<MonomialKey, MonomialKeyHash> monomial_to_var;
+    // Same mapping when every variable is binary (multilinear mode)
+    FlatMonomialMap<MultilinearKey, MultilinearKeyHash> multilinear_to_var;
+    bool multilinear = false;
     
     // Block structure info
     std::vector<int> block_struct; // Size of each block (positive = matrix, negative = diagonal)
@@ -51,37 +458,182 @@ struct StreamingContext {
     
     // Objective coefficients (indexed by variable number)
     std::vector<double> obj_coef;
-    // used in pass 2
+    // used in pass 2; written through writer
     FILE* output_file = nullptr;
+    SdpaWriter writer;
     // Pass indicator
     bool is_counting_pass = true;
+    // Single-pass mode: monomials are registered while the entries go to a
+    // binary spill file; the header and the entries are written at the end
+    bool single_pass = false;
+    FILE* spill_file = nullptr;
+    std::vector<SpillRecord> spill_buffer;
+    // Write the binary .sdpb container instead of SDPA text; sdpb is its
+    // header, completed by finalize_file
+    bool binary = false;
+    SdpbHeader sdpb = {};
+    std::vector<int64_t> block_nnz;   // entries written per block (index = block)
+    // Pack the diagonal contributions (equalities, 1x1 inequalities and 1x1
+    // moment matrices) into one LP block, emitted last: lp_rows is the running
+    // row offset. Its entries are buffered in lp_entries; once ROW_CHUNK of
+    // them are held, the next begin_diag coalesces the buffer and appends it to
+    // lp_store (an unnamed temporary file), which is copied after the other
+    // blocks. A chunk ends between items, so no row is split across chunks
+    bool pack_lp = false;
+    int lp_rows = 0;
+    std::vector<SpillRecord> lp_entries;
+    FILE* lp_store = nullptr;
+    static const size_t ROW_CHUNK = (size_t)1 << 16;
+    // Native equalities (CBF output): equality rows are kept out of the SDP
+    // blocks as eq_rows linear rows; their entries go through eq_entries and
+    // eq_store the same way and are read back by write_cbf
+    bool native_eq = false;
+    int eq_rows = 0;
+    std::vector<SpillRecord> eq_entries;
+    FILE* eq_store = nullptr;
+    // Coalescing: the entries of the current block are buffered, then sorted by
+    // (var, row, col), duplicates summed and sums below drop_tol dropped
+    bool coalesce = false;
+    double drop_tol = 1.0e-12;
+    std::vector<SpillRecord> block_entries;
+    int64_t coalesced_entries = 0;   // entries removed by coalescing
+    // Duplicate blocks: when building the structure each finished block is
+    // hashed from its coalesced entries and dropped if an identical block was
+    // kept before (the entry lists of kept blocks go to block_store, an
+    // unnamed temporary file, and are compared on a hash match); dropped[b] marks the b-th begun block (raw_blocks counts
+    // them) so the writing pass skips the same ones. A worker of the parallel
+    // counting pass defers the decision: it keeps its blocks' entries in
+    // dedup_entries (block b in [dedup_ptr[b], dedup_ptr[b + 1])) for absorb
+    bool dedup_blocks = false;
+    bool defer_dedup = false;
+    std::unordered_multimap<BlockKey, int64_t, BlockKeyHash> seen_blocks;   // -> offset in block_store
+    FILE* block_store = nullptr;
+    std::vector<char> dropped;
+    int raw_blocks = 0;
+    bool block_open = false;
+    int open_size = 0;
+    bool skipping = false;           // the current block is a dropped duplicate
+    std::vector<SpillRecord> dedup_entries;
+    std::vector<int64_t> dedup_ptr = {0};
+    int duplicate_blocks = 0;
+    int64_t duplicate_entries = 0;
+    // Out-of-core numbering (monomial_budget > 0, serial two passes only): pass 1
+    // spills the monomial map to monomial_index whenever it holds more than
+    // monomial_budget bytes and finalize_counting assigns the numbers; in pass 2
+    // the map is a cache of looked-up numbers, emptied when it outgrows the budget
+    size_t monomial_budget = 0;
+    OutOfCoreIndex monomial_index;
     // Current block being processed
     int current_block = 0;
     // Entry count for current block
     int current_block_entries = 0;
     int total_entries = 0; // total count of matrix entries written 
 
-    const std::vector<int>* binvec_ptr = nullptr;
-    const std::vector<int>* Sqvec_ptr = nullptr;
-    
+    // binary / square-one flags of the variables (null: no exponent reduction)
+    const VarFlags* var_flags = nullptr;
+
+    // Parallel conversion: a worker context looks monomials up in shared's maps
+    // and formats its entries into text_out; verbose=false silences per-block notes
+    const StreamingContext* shared = nullptr;
+    std::string* text_out = nullptr;
+    bool verbose = true;
     
     // Register a monomial, returns its variable number (1-indexed for SDPA format)
     int register_monomial(const MonomialKey& key);
+    int register_monomial(const MultilinearKey& key);
     
     // Look up variable number for a monomial (pass 2)
-    int get_var_number(const MonomialKey& key) const;
+    int get_var_number(const MonomialKey& key);
+    int get_var_number(const MultilinearKey& key);
+
+    // monomial_budget: record key for the index (its number is not known yet)
+    template <class Key, class Hash>
+    void spill_monomial(FlatMonomialMap<Key, Hash>& map, const Key& key) {
+        map.find_or_insert(key, 0);
+        if (map.memory_bytes() > monomial_budget) {
+            monomial_index.spill(map);
+            map.clear();
+        }
+    }
+    // monomial_budget: number of key from the index, cached in map
+    template <class Key, class Hash>
+    int resolve_monomial(FlatMonomialMap<Key, Hash>& map, const Key& key) {
+        int var_num = monomial_index.find(key.packed(), key.packed_size());
+        if (var_num < 0) return -1;
+        if (map.memory_bytes() > monomial_budget) map.clear();
+        map.find_or_insert(key, var_num);
+        return var_num;
+    }
+
+    // true when this sweep registers monomials and block sizes
+    bool builds_structure() const { return is_counting_pass || single_pass; }
+    // true when this sweep computes entries (the counting pass does so only to
+    // hash blocks for duplicate elimination)
+    bool collects_entries() const { return !is_counting_pass || dedup_blocks; }
+
+    // Variable number of a monomial: registered when building the structure,
+    // looked up in the writing pass
+    template <class Key>
+    int lookup_monomial(const Key& key) {
+        return builds_structure() ? register_monomial(key) : get_var_number(key);
+    }
     
     // Start a new block
     void start_block(int block_size);
+    // Start the next block: records its size when building the structure
+    void begin_block(int block_size);
     
-    // Write an SDP entry (pass 2 only)
+    // Write an SDP entry (pass 2 / single pass only)
     void write_entry(int var_num, int block, int row, int col, double coef);
+    // coalesce: write out the buffered entries of the current block
+    void flush_block_entries();
+    // sort, sum and drop buffered entries / write out those of the current block
+    void canonicalize_entries(std::vector<SpillRecord>& e);
+    void emit_block_entries();
+    // Close the current block: with dedup_blocks, keep or drop it
+    void finish_block();
+    // dedup_blocks: true if no identical block was kept before (then records it);
+    // a block that only shares the hash of a kept block is kept
+    bool keep_block(int block_size, const SpillRecord* e, size_t n);
+    // true if the raw_block-th block was dropped in the structure sweep
+    bool is_dropped(int raw_block) const;
+    // write an entry to text_out, the spill file or output_file
+    void emit_entry(int var_num, int block, int row, int col, double coef);
+
+    // Diagonal contributions: begin_diag reserves rows and returns the offset
+    // to add to their 1-based positions (a block of its own unless pack_lp);
+    // write_diag writes the diagonal entry (row, row)
+    int begin_diag(int rows);
+    void write_diag(int var_num, int row, double coef);
+    // native_eq: reserve equality rows (returns the row offset) / write an entry
+    int begin_eq(int rows);
+    void write_eq(int var_num, int row, double coef);
+    // pack_lp: add the LP block to the structure / write its entries
+    void close_lp_block();
+    void flush_lp_block();
+    // Coalesce the buffered rows e and append them to store (opened on first
+    // use) when at least ROW_CHUNK are held, or whenever force is set
+    void spill_rows(std::vector<SpillRecord>& e, FILE*& store, bool force);
+
+    // writer, attached to output_file on first use
+    SdpaWriter& out();
+
+    // Single pass: push buffered records to the spill file; copy them to output_file
+    void flush_spill();
+    void copy_spill();
+
+    // Register the monomials and blocks of a worker's counting pass, with the
+    // monomials in the worker's first-appearance order; returns the number of
+    // blocks kept
+    int absorb(const StreamingContext& local);
     
     // Finalize pass 1 (prepare for pass 2)
     void finalize_counting();
     
     // Write SDPA header (beginning of pass 2)
     void write_header(const std::string& filename);
+    // Binary container: header, block structure and objective
+    void write_sdpb_header();
     
     // Write SDPA footer / finalize file
     void finalize_file();
@@ -104,10 +656,15 @@ void stream_psdp_to_file(
     std::vector<class poly_info>& polyinfo,
     std::vector<class spvec_array>& bassinfo,
     const std::string& sdpafile, 
-    const std::vector<int>& binvec = {}, 
-    const std::vector<int>& Sqvec = {}
+    const VarFlags* var_flags = nullptr,
+    bool single_pass = true,  // on one thread: single pass through a spill file
+    SdpFormat format = SDP_TEXT,
+    size_t monomial_budget = 0  // > 0: out-of-core monomial numbering within this many bytes
 );
 
 void test_streaming_basics(); 
 
+// Microbenchmark: pass-1 style monomial registration, std::unordered_map vs FlatMonomialMap
+void bench_monomial_map(int num_vars = 2000, int num_keys = 2000000);
+
 #endif // _STREAMING_H_
\ No newline at end of file
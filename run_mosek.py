@@ -33,19 +33,56 @@ def parse_sdpa(path):
     return mDim, nBlock, bsizes, b, entries
 
 
+# Binary SDP container written with sdpFormat = binary (layout in streaming.h)
+SDPB_HEADER = np.dtype([('magic', 'S8'), ('version', '<u4'), ('header_bytes', '<u4'),
+                        ('mDim', '<i4'), ('nBlocks', '<i4'), ('nnz', '<i8'),
+                        ('blocks_offset', '<i8'), ('obj_offset', '<i8'),
+                        ('entries_offset', '<i8'), ('ptr_offset', '<i8')])
+SDPB_ENTRY = np.dtype([('var', '<i4'), ('block', '<i4'), ('row', '<i4'),
+                       ('col', '<i4'), ('coef', '<f8')])
+
+
+def load_sdpb(path):
+    h = np.memmap(path, dtype=SDPB_HEADER, mode='r', shape=(1,))[0]
+    if h['magic'] != b'SPOPSDPB' or h['version'] != 1:
+        raise ValueError(f"{path} is not a version 1 .sdpb file")
+    mDim, nBlock, nnz = int(h['mDim']), int(h['nBlocks']), int(h['nnz'])
+    bsizes = np.memmap(path, dtype='<i4', mode='r',
+                       offset=int(h['blocks_offset']), shape=(nBlock,))
+    b = np.memmap(path, dtype='<f8', mode='r',
+                  offset=int(h['obj_offset']), shape=(mDim,))
+    entries = np.memmap(path, dtype=SDPB_ENTRY, mode='r',
+                        offset=int(h['entries_offset']), shape=(nnz,))
+    block_ptr = np.memmap(path, dtype='<i8', mode='r',
+                          offset=int(h['ptr_offset']), shape=(nBlock + 1,))
+    return mDim, nBlock, list(bsizes), np.asarray(b), entries, block_ptr
+
+
 def solve(dat_file, solver=cp.MOSEK, verbose=True):
     print(f"Parsing {dat_file} ...")
-    mDim, nBlock, bsizes, b_obj, entries = parse_sdpa(dat_file)
+    if dat_file.endswith(".cbf"):
+        raise ValueError(f"{dat_file}: CBF output is export-only, solve the .dat-s or .sdpb file")
+    if dat_file.endswith(".sdpb"):
+        mDim, nBlock, bsizes, b_obj, entries, block_ptr = load_sdpb(dat_file)
+    else:
+        mDim, nBlock, bsizes, b_obj, entries = parse_sdpa(dat_file)
+        block_ptr = None
     print(f"  mDim={mDim}, nBlock={nBlock}, block sizes={bsizes}")
     print(f"  Total entries: {len(entries)}")
 
     y = cp.Variable(mDim, name="y")
     constraints = []
 
-    # group entries by block number
+    # group entries by block number (an .sdpb file is already grouped)
     by_block = defaultdict(list)
-    for (v, blk, r, c, val) in entries:
-        by_block[blk].append((v, r, c, val))
+    if block_ptr is not None:
+        for blk in range(1, nBlock + 1):
+            e = entries[block_ptr[blk - 1]:block_ptr[blk]]
+            by_block[blk] = list(zip(e['var'].tolist(), e['row'].tolist(),
+                                     e['col'].tolist(), e['coef'].tolist()))
+    else:
+        for (v, blk, r, c, val) in entries:
+            by_block[blk].append((v, r, c, val))
 
     print("Building SDP constraints ...")
     for blk_idx, bsize in enumerate(bsizes):
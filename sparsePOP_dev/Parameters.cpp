@@ -57,8 +57,13 @@ pop_params::pop_params(){
 	POPsolver		= "";
 	errorBdIdxSW		= 0;
 	errorBdIdxVec.resize(0);
-	Method 			= "symamd";
+	Method 			= "amd";
 	aggressiveSW		= 0;
+	cliqueMergeThreshold	= -1.0;
+	termSparsityIter	= 0;
+	termSparsityTS		= "block";
+	sdpFormat		= "text";
+	monomialMemoryMB	= 0;
 }
 void pop_params::write_parameters(string fname){
 	
@@ -118,6 +123,11 @@ void pop_params::write_parameters(string fname){
 	if(this->aggressiveSW == 1){
 		fprintf(fp,"  aggressiveSW       = 1 // for developers of SparsePOP \n");
 	}
+	fprintf(fp,"  cliqueMergeThreshold = %6.2e\n", cliqueMergeThreshold);
+	fprintf(fp,"  termSparsityIter   = %d\n", termSparsityIter);
+	fprintf(fp,"  termSparsityTS     = %s\n", termSparsityTS.c_str());
+	fprintf(fp,"  sdpFormat          = %s\n", sdpFormat.c_str());
+	fprintf(fp,"  monomialMemoryMB   = %d\n", monomialMemoryMB);
 	fprintf(fp, "\n");
 	fclose(fp);
 }
@@ -173,6 +183,11 @@ void pop_params::disp_parameters(){
 	if(this->aggressiveSW == 1){
 		cout << "  aggressiveSW       = 1 // for developers of SparsePOP" << endl;
 	}
+	cout << "  cliqueMergeThreshold = " << cliqueMergeThreshold << endl;
+	cout << "  termSparsityIter   = " << termSparsityIter << endl;
+	cout << "  termSparsityTS     = " << termSparsityTS << endl;
+	cout << "  sdpFormat          = " << sdpFormat << endl;
+	cout << "  monomialMemoryMB   = " << monomialMemoryMB << endl;
 	cout << endl;
 }
 
@@ -206,6 +221,11 @@ void   pop_params::mxSetParameters(const mxArray *data){
 	mxSetMex(data);
 	mxSetErrorBoundVec(data);
 	mxSetAggressiveSW(data);
+	mxSetCliqueMergeThreshold(data);
+	mxSetTermSparsityIter(data);
+	mxSetTermSparsityTS(data);
+	mxSetSdpFormat(data);
+	mxSetMonomialMemoryMB(data);
 	print_msg("End to set param");
 }
 void pop_params::mxSetRelaxOrder(const mxArray *data){
@@ -671,11 +691,65 @@ void pop_params::mxSetAggressiveSW(const mxArray *data){
 		aggressiveSW = 0;
 	}
 }
+void pop_params::mxSetCliqueMergeThreshold(const mxArray *data){
+	print_msg("cliqueMergeThreshold");
+	const mxArray *pm;
+	pm = mxGetField(data, 0, "cliqueMergeThreshold");
+	if(pm != NULL ){
+		cliqueMergeThreshold = mxGetScalar(pm);
+	}else{
+		cliqueMergeThreshold = -1.0;
+	}
+}
+void pop_params::mxSetTermSparsityIter(const mxArray *data){
+	print_msg("termSparsityIter");
+	const mxArray *pm;
+	pm = mxGetField(data, 0, "termSparsityIter");
+	if(pm != NULL ){
+		termSparsityIter = (int) mxGetScalar(pm);
+	}else{
+		termSparsityIter = 0;
+	}
+}
+void pop_params::mxSetTermSparsityTS(const mxArray *data){
+	print_msg("termSparsityTS");
+	const mxArray *pm;
+	pm = mxGetField(data, 0, "termSparsityTS");
+	if(pm != NULL && mxIsChar(pm)){
+		char *str = mxArrayToString(pm);
+		termSparsityTS = str;
+		mxFree(str);
+	}else{
+		termSparsityTS = "block";
+	}
+}
+void pop_params::mxSetSdpFormat(const mxArray *data){
+	print_msg("sdpFormat");
+	const mxArray *pm;
+	pm = mxGetField(data, 0, "sdpFormat");
+	if(pm != NULL && mxIsChar(pm)){
+		char *str = mxArrayToString(pm);
+		sdpFormat = str;
+		mxFree(str);
+	}else{
+		sdpFormat = "text";
+	}
+}
+void pop_params::mxSetMonomialMemoryMB(const mxArray *data){
+	print_msg("monomialMemoryMB");
+	const mxArray *pm;
+	pm = mxGetField(data, 0, "monomialMemoryMB");
+	if(pm != NULL ){
+		monomialMemoryMB = (int) mxGetScalar(pm);
+	}else{
+		monomialMemoryMB = 0;
+	}
+}
 #else
 void pop_params::SetParameters(string pname, int dimvar){
 	ifstream pf(pname.c_str());
-	vector<string> strtype,values;
-	string line,tmp1,tmp2;
+	vector<string> names,strtype,values;
+	string line,tmp0,tmp1,tmp2;
 	string::iterator it;
 	int pos1,pos2,size;
 	if(pf.is_open()){
@@ -695,8 +769,10 @@ void pop_params::SetParameters(string pname, int dimvar){
 			pos1 = line.find(",");
 			pos2 = line.find(",",pos1+1);
 			size = line.find(";"); 
+			tmp0 = line.substr(0,pos1);
 			tmp1 = line.substr(pos1+1,pos2-pos1-1);
 			tmp2 = line.substr(pos2+1,size-pos2-1);
+			names.push_back(tmp0);
 			strtype.push_back(tmp1);
 			values.push_back(tmp2);
 			/*
@@ -733,10 +809,27 @@ void pop_params::SetParameters(string pname, int dimvar){
 	SetPrintFileName(strtype[19], values[19]);
 	SetPrintLevel(values[20], values[21]);
 	SetMethod(strtype[22], values[22]);
-	if(values.size() >= 24){
-		SetAggressiveSW(values[23]);
-	}else{
-		aggressiveSW = 0;	
+	/* optional parameters after Method are looked up by name */
+	aggressiveSW = 0;	
+	cliqueMergeThreshold = -1.0;
+	termSparsityIter = 0;
+	termSparsityTS = "block";
+	sdpFormat = "text";
+	monomialMemoryMB = 0;
+	for(int i=23; i<(int)values.size(); i++){
+		if(names[i] == "aggressiveSW"){
+			SetAggressiveSW(values[i]);
+		}else if(names[i] == "cliqueMergeThreshold"){
+			SetCliqueMergeThreshold(values[i]);
+		}else if(names[i] == "termSparsityIter"){
+			SetTermSparsityIter(values[i]);
+		}else if(names[i] == "termSparsityTS"){
+			SetTermSparsityTS(strtype[i], values[i]);
+		}else if(names[i] == "sdpFormat"){
+			SetSdpFormat(strtype[i], values[i]);
+		}else if(names[i] == "monomialMemoryMB"){
+			SetMonomialMemoryMB(values[i]);
+		}
 	}
 }
 void   pop_params::SetRelaxOrder(string value){
@@ -912,8 +1005,8 @@ void   pop_params::SetMethod(string strtype, string value){
 		exit(EXIT_FAILURE);
 	}
 	Method = value;
-	if(Method != "symamd" && Method != "metis"){
-		cout << " ## Error: should be metis or symamd in param.Method." << endl;
+	if(Method != "amd" && Method != "symamd" && Method != "metis"){
+		cout << " ## Error: should be amd, metis or symamd in param.Method." << endl;
 		exit(EXIT_FAILURE);
 	}else{
 		//cout << param.Method << endl;
@@ -926,5 +1019,54 @@ void   pop_params::SetAggressiveSW(string value){
 		aggressiveSW = atoi(value.c_str());
 	}
 }
+void   pop_params::SetCliqueMergeThreshold(string value){
+	if(value.empty()){
+		cliqueMergeThreshold = -1.0;
+	}else{
+		cliqueMergeThreshold = atof(value.c_str());
+	}
+}
+void   pop_params::SetTermSparsityIter(string value){
+	if(value.empty()){
+		termSparsityIter = 0;
+	}else{
+		termSparsityIter = atoi(value.c_str());
+	}
+}
+void   pop_params::SetTermSparsityTS(string strtype, string value){
+	if(strtype != "string"){
+		cout << " ## Error: in param.pop. " << endl;
+		cout << " ##        Should be string at the second column of termSparsityTS." << endl;
+		exit(EXIT_FAILURE);
+	}
+	termSparsityTS = value.empty() ? "block" : value;
+	if(termSparsityTS != "block" && termSparsityTS != "chordal"){
+		cout << " ## Error: should be block or chordal in param.termSparsityTS." << endl;
+		exit(EXIT_FAILURE);
+	}
+}
+void   pop_params::SetSdpFormat(string strtype, string value){
+	if(strtype != "string"){
+		cout << " ## Error: in param.pop. " << endl;
+		cout << " ##        Should be string at the second column of sdpFormat." << endl;
+		exit(EXIT_FAILURE);
+	}
+	sdpFormat = value.empty() ? "text" : value;
+	if(sdpFormat != "text" && sdpFormat != "binary" && sdpFormat != "cbf"){
+		cout << " ## Error: should be text, binary or cbf in param.sdpFormat." << endl;
+		exit(EXIT_FAILURE);
+	}
+}
+void   pop_params::SetMonomialMemoryMB(string value){
+	if(value.empty()){
+		monomialMemoryMB = 0;
+	}else{
+		monomialMemoryMB = atoi(value.c_str());
+	}
+	if(monomialMemoryMB < 0){
+		cout << " ## Error: should be nonnegative in param.monomialMemoryMB." << endl;
+		exit(EXIT_FAILURE);
+	}
+}
 #endif /* MATLAB_MEX_FILE */
  
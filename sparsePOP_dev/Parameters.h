@@ -72,6 +72,25 @@ public:
 	string Method;
 	//8. Paramters for developers of SparsePOP.
 	int aggressiveSW;
+	//9. Clique merging: a parent and a child clique are merged when
+	//   (block of union)^3 <= sum of blocks^3 + cliqueMergeThreshold * (shared moments),
+	//   i.e. the threshold is the cost of one shared moment. A negative value
+	//   (the default) disables the merging.
+	double cliqueMergeThreshold;
+	//10. Term sparsity: number of TSSOS-style iterations splitting moment and
+	//    localizing matrices into blocks. 0 keeps the full matrices.
+	int termSparsityIter;
+	//    "block" splits into connected components, "chordal" into the maximal
+	//    cliques of a chordal extension of the term sparsity graph.
+	string termSparsityTS;
+	//11. Output of the streamed SDP: "text" (SDPA sparse format, .dat-s),
+	//    "binary" (memory-mappable .sdpb container, see streaming.h) or
+	//    "cbf" (CBF conic file with native equality rows).
+	string sdpFormat;
+	//12. Memory budget (MB) of the monomial numbering. 0 keeps every monomial
+	//    in memory; a positive value numbers them out of core (sorted runs on
+	//    disk, see OutOfCoreIndex in streaming.h).
+	int monomialMemoryMB;
 	
 	//Functions
 	pop_params();
@@ -111,6 +130,11 @@ public:
 	void   mxSetMex(const mxArray *data);
 	void   mxSetErrorBoundVec(const mxArray *data);
 	void   mxSetAggressiveSW(const mxArray *data);
+	void   mxSetCliqueMergeThreshold(const mxArray *data);
+	void   mxSetTermSparsityIter(const mxArray *data);
+	void   mxSetTermSparsityTS(const mxArray *data);
+	void   mxSetSdpFormat(const mxArray *data);
+	void   mxSetMonomialMemoryMB(const mxArray *data);
 	#else
 	void   SetParameters(string pname, int dimvar);
 	void   SetRelaxOrder(string value);
@@ -136,6 +160,11 @@ public:
 	void   SetPrintLevel(string value1, string value2);
 	void   SetMethod(string strtype, string value);
 	void   SetAggressiveSW(string value);
+	void   SetCliqueMergeThreshold(string value);
+	void   SetTermSparsityIter(string value);
+	void   SetTermSparsityTS(string strtype, string value);
+	void   SetSdpFormat(string strtype, string value);
+	void   SetMonomialMemoryMB(string value);
 	#endif /* MATLAB_MEX_FILE */
 };
 
@@ -83,6 +83,134 @@ void cliques::write_maxCliques(string fname){
     fout.close();
 }
 
+/* size of the moment matrix of a clique with csize variables: C(csize+r, r) */
+static double clique_block_size(int csize, int r){
+    double b = 1.0;
+    for(int i=1; i<=r; i++){
+        b = b * (csize + i) / i;
+    }
+    return b;
+}
+void merge_cliques(int relaxOrder, double threshold, string fname, class cliques & macls){
+    
+    int nc = macls.numcliques;
+    if(threshold < 0 || nc < 2 || (int)macls.parent.size() != nc){
+        return;
+    }
+    /* visit children before parents: sort by depth in the clique tree */
+    vector<int> depth(nc, -1);
+    vector<int> path;
+    for(int c=0; c<nc; c++){
+        path.clear();
+        int p = c;
+        while(p >= 0 && depth[p] < 0){
+            path.push_back(p);
+            p = macls.parent[p];
+        }
+        int d = (p >= 0 ? depth[p] + 1 : 0);
+        for(int i=path.size()-1; i>=0; i--){
+            depth[path[i]] = d++;
+        }
+    }
+    vector<int> order(nc);
+    for(int c=0; c<nc; c++){
+        order[c] = c;
+    }
+    stable_sort(order.begin(), order.end(), [&](int a, int b){ return depth[a] > depth[b]; });
+    
+    vector<vector<int> > sets(nc);
+    vector<int> rep(nc);
+    int maxBefore = 0;
+    for(int c=0; c<nc; c++){
+        sets[c].assign(macls.clique[c].begin(), macls.clique[c].end());
+        sort(sets[c].begin(), sets[c].end());
+        rep[c] = c;
+        maxBefore = max(maxBefore, (int)sets[c].size());
+    }
+    
+    std::ofstream fout;
+    if(fname.empty() == false){
+        fout.open(fname.c_str(), ios::app);
+        fout << "# Clique merging (threshold = " << threshold << ")" << endl;
+    }
+    int numMerges = 0;
+    vector<int> uni;
+    for(int k=0; k<nc; k++){
+        int c = order[k];
+        if(macls.parent[c] < 0){
+            continue;
+        }
+        int p = macls.parent[c];
+        while(rep[p] != p){
+            p = rep[p];
+        }
+        uni.clear();
+        set_union(sets[p].begin(), sets[p].end(), sets[c].begin(), sets[c].end(), back_inserter(uni));
+        int sepsize = sets[p].size() + sets[c].size() - uni.size();
+        double bp = clique_block_size(sets[p].size(), relaxOrder);
+        double bc = clique_block_size(sets[c].size(), relaxOrder);
+        double bu = clique_block_size(uni.size(), relaxOrder);
+        /* moments of degree 1..2r in the separator are shared by both blocks; */
+        /* each one costs a linking constraint, so the term is linear in ms    */
+        double ms = clique_block_size(sepsize, 2*relaxOrder) - 1;
+        double before = bp*bp*bp + bc*bc*bc + threshold*ms;
+        double after = bu*bu*bu;
+        if(after <= before){
+            if(fout.is_open()){
+                fout << "merge clique " << c+1 << " (" << sets[c].size() << ") into " << p+1
+                     << " (" << sets[p].size() << "), separator " << sepsize
+                     << ", cost " << before << " -> " << after << endl;
+            }
+            sets[p].swap(uni);
+            vector<int>().swap(sets[c]);
+            rep[c] = p;
+            numMerges++;
+        }
+    }
+    if(numMerges == 0){
+        if(fout.is_open()){
+            fout << endl;
+            fout.close();
+        }
+        printf("## Clique merging: no merges (%d cliques)\n", nc);
+        return;
+    }
+    
+    /* rebuild the clique list and the tree over the surviving cliques */
+    vector<int> newIdx(nc, -1);
+    int nn = 0;
+    int maxAfter = 0;
+    for(int c=0; c<nc; c++){
+        if(rep[c] == c){
+            newIdx[c] = nn++;
+        }
+    }
+    vector<list<int> > newClique(nn);
+    vector<int> newParent(nn, -1);
+    for(int c=0; c<nc; c++){
+        if(rep[c] != c){
+            continue;
+        }
+        newClique[newIdx[c]].assign(sets[c].begin(), sets[c].end());
+        maxAfter = max(maxAfter, (int)sets[c].size());
+        int p = macls.parent[c];
+        if(p >= 0){
+            while(rep[p] != p){
+                p = rep[p];
+            }
+            newParent[newIdx[c]] = newIdx[p];
+        }
+    }
+    macls.clique.swap(newClique);
+    macls.parent.swap(newParent);
+    macls.numcliques = nn;
+    if(fout.is_open()){
+        fout << endl;
+        fout.close();
+    }
+    printf("## Clique merging: %d merge(s), %d -> %d cliques, max size %d -> %d\n",
+        numMerges, nc, nn, maxBefore, maxAfter);
+}
 
 void gen_maxcliques3(int msize, vector<int> oriidx, class SparseMat & extofcsp, class cliques & macls){
     
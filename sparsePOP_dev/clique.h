@@ -24,12 +24,18 @@
 
 #include "global.h"
 void gen_maxcliques3(int msize, vector<int> oriidx, class SparseMat & extofcsp, class cliques & macls);
+/* Greedy merging of parent and child cliques along the clique tree (macls.parent). */
+/* A child is merged into its parent when the moment matrix of the union is cheaper */
+/* than the two blocks plus the cost of the moments they share; see                 */
+/* cliqueMergeThreshold.                                                           */
+void merge_cliques(int relaxOrder, double threshold, string fname, class cliques & macls);
 
 class cliques{
 public:
     int numnode;
     int numcliques;
     vector<list<int> > clique;
+    vector<int> parent;	// clique tree: parent clique, -1 for a root (empty if unknown)
     cliques();
     ~cliques();
     
@@ -23,7 +23,9 @@
 #include <string>
 #include <cstring>
 #include <unordered_map>
+#include <unordered_set>
 #include "conversion.h"
+#include "cspGraph.h"
 #include "streaming.h"
 
 
@@ -797,24 +799,21 @@ void get_removelist(/*IN*/ int * alist, class spvec_array & allsups, class spvec
     }
     
 }	
-void remove_Binarysups(class mysdp & psdp, vector<int> binvec){
-	int sval, bidx, spidx, j, idx;
-	int bsize = binvec.size();
-	for(bidx=0;bidx<bsize;bidx++){
-		for(spidx=0;spidx<psdp.ele.sup.pnz_size;spidx++){
-			if(psdp.ele.sup.pnz[0][spidx] >= 0){
-				for(j=0; j<psdp.ele.sup.pnz[1][spidx]; j++){
-					idx = psdp.ele.sup.pnz[0][spidx]+j;
-					sval = psdp.ele.sup.vap[1][idx];
-					if(sval > 1 && psdp.ele.sup.vap[0][idx] == binvec[bidx]){
-						psdp.ele.sup.vap[1][idx] = 1;
-					}
+void remove_Binarysups(class mysdp & psdp, const class VarFlags & flags){
+	int sval, spidx, j, idx;
+	for(spidx=0;spidx<psdp.ele.sup.pnz_size;spidx++){
+		if(psdp.ele.sup.pnz[0][spidx] >= 0){
+			for(j=0; j<psdp.ele.sup.pnz[1][spidx]; j++){
+				idx = psdp.ele.sup.pnz[0][spidx]+j;
+				sval = psdp.ele.sup.vap[1][idx];
+				if(sval > 1 && flags.isBinary(psdp.ele.sup.vap[0][idx])){
+					psdp.ele.sup.vap[1][idx] = 1;
 				}
 			}
 		}
 	}
 }
-void remove_SquareOnesups(class mysdp & psdp, vector<int> Sqvec){
+void remove_SquareOnesups(class mysdp & psdp, const class VarFlags & flags){
 	class supSet supsets,tmpsupSet;
 	class sup tmpsup;
 	initialize_supset(psdp.ele.sup, supsets);
@@ -825,11 +824,8 @@ void remove_SquareOnesups(class mysdp & psdp, vector<int> Sqvec){
 	for(ite = supsets.begin(); ite != supsets.end(); ++ite){
 		(*ite).getIdxsVals(idx, val);
 		for(int i=0; i<idx.size(); i++){
-			for(int j=0; j<Sqvec.size(); j++){
-				if(idx[i] == Sqvec[j]){
-					val[i] = (val[i] % 2);
-					break;
-				}
+			if(flags.isSquareOne(idx[i])){
+				val[i] = (val[i] % 2);
 			}
 			if(val[i] != 0){
 				tmpsup.push(idx[i], val[i]);
@@ -962,18 +958,15 @@ void remove_sups(class mysdp & psdp, class spvec_array & removesups){
     psdp.nBlocks = nnznoblock;
     //cout<<"<--- remove_sups ( for psdp) <*** "<<endl<<endl;
 }
-void remove_Binarysups(vector<int> binvec, class spvec_array & allsups){
-	int sval, bidx, spidx, j, idx;
-	int bsize = binvec.size();
-	for(bidx=0;bidx<bsize;bidx++){
-		for(spidx=0;spidx<allsups.pnz_size;spidx++){
-			if(allsups.pnz[0][spidx] >= 0){
-				for(j=0; j<allsups.pnz[1][spidx]; j++){
-					idx = allsups.pnz[0][spidx]+j;
-					sval = allsups.vap[1][idx];
-					if(sval > 1 && allsups.vap[0][idx] == binvec[bidx]){
-						allsups.vap[1][idx] = 1;
-					}
+void remove_Binarysups(const class VarFlags & flags, class spvec_array & allsups){
+	int sval, spidx, j, idx;
+	for(spidx=0;spidx<allsups.pnz_size;spidx++){
+		if(allsups.pnz[0][spidx] >= 0){
+			for(j=0; j<allsups.pnz[1][spidx]; j++){
+				idx = allsups.pnz[0][spidx]+j;
+				sval = allsups.vap[1][idx];
+				if(sval > 1 && flags.isBinary(allsups.vap[0][idx])){
+					allsups.vap[1][idx] = 1;
 				}
 			}
 		}
@@ -991,7 +984,7 @@ void remove_Binarysups(vector<int> binvec, class spvec_array & allsups){
 	allsups.pnz_size = ridx;
 	simplification(allsups);
 }
-void remove_SquareOnesups(vector<int> Sqvec, class spvec_array & allsups){
+void remove_SquareOnesups(const class VarFlags & flags, class spvec_array & allsups){
 	//cout<<" ***> remove_SquareOnesups ---> "<<endl;
 	class supSet supsets,tmpsupSet;
 	class sup tmpsup;
@@ -1003,11 +996,8 @@ void remove_SquareOnesups(vector<int> Sqvec, class spvec_array & allsups){
 	for(ite = supsets.begin(); ite != supsets.end(); ++ite){
 		(*ite).getIdxsVals(idx, val);
 		for(int i=0; i<idx.size(); i++){
-			for(int j=0; j<Sqvec.size(); j++){
-				if(idx[i] == Sqvec[j]){
-					val[i] = (val[i] % 2);
-					break;
-				}
+			if(flags.isSquareOne(idx[i])){
+				val[i] = (val[i] % 2);
 			}
 			if(val[i] != 0){
 				tmpsup.push(idx[i], val[i]);
@@ -1386,27 +1376,26 @@ void s3r::write_BasisIndices(string fname){
 
 //genBasisSupports
 void s3r::genBasisSupports(class supsetSet & BasisSupports){
-    int i;
     int rowSize=bindices.size();
     int nDim=this->Polysys.dimvar();
+    int numSys=this->Polysys.numsys();
     
-    int nVars;
-    list<class sup> List;
-    class supSet Moment;
-    int sosDim;
-    BasisSupports.push(Moment);
-    for(i=1;i<rowSize;i++){
-        nVars=0;
-        nVars = bindices[i].size();
-        List.clear();
-        if(i<this->Polysys.numsys()){
+    // each basis depends only on its own constraint and clique, so the
+    // bases are generated in parallel into pre-sized slots
+    int base = BasisSupports.supsetArray.size();
+    BasisSupports.supsetArray.resize(base + (rowSize > 0 ? rowSize : 1));
+    #pragma omp parallel for schedule(dynamic)
+    for(int i=1;i<rowSize;i++){
+        class supSet & Moment = BasisSupports.supsetArray[base+i];
+        list<class sup> List;
+        int nVars = bindices[i].size();
+        int sosDim;
+        if(i<numSys){
             // special case for degree 0 constraints
             if (this->Polysys.polyDegree(i) == 0){
                 // give it an empty basis
-                List.clear();
                 Moment.dimVar = this->Polysys.dimVar;
                 Moment.setSupSet(nDim, List);
-                BasisSupports.push(Moment);
                 continue; // go to next constraint
             }
 
@@ -1421,12 +1410,10 @@ void s3r::genBasisSupports(class supsetSet & BasisSupports){
             
             // linear bounds (degree-1 single variable): give constant basis (1x1 block)
             if (this->Polysys.polyDegree(i) == 1 && nVars == 1) {
-                List.clear();
                 class sup constSup; // constant monomial (no variables)
                 List.push_back(constSup);
                 Moment.dimVar = this->Polysys.dimVar;
                 Moment.setSupSet(nDim, List);
-                BasisSupports.push(Moment);
                 continue;
             }
 
@@ -1446,13 +1433,18 @@ void s3r::genBasisSupports(class supsetSet & BasisSupports){
         }
         Moment.dimVar = this->Polysys.dimVar;
         Moment.setSupSet(nDim, List);
-        Moment.changeIndicesAll(bindices[i]);
-        BasisSupports.push(Moment);
-
+        // local index -> variable of the clique (same as changeIndicesAll, without walking the list)
+        vector<int> pattern(bindices[i].begin(), bindices[i].end());
+        list<class sup>::iterator ite;
+        for(ite = Moment.supList.begin(); ite != Moment.supList.end(); ++ite){
+            for(int k=0; k<(*ite).idx.size(); k++){
+                (*ite).idx[k] = pattern[(*ite).idx[k]];
+            }
+        }
     }
 }
 
-void s3r::eraseBinaryInObj(vector<int> binvec){
+void s3r::eraseBinaryInObj(const class VarFlags & flags){
 	//cout<<" ***> s3r::eraseBinaryInObj ---> "<<endl;
 	list<mono>::iterator bite = Polysys.polynomial[0].monoList.begin();
 	list<mono>::iterator eite = Polysys.polynomial[0].monoList.end();
@@ -1465,11 +1457,8 @@ void s3r::eraseBinaryInObj(vector<int> binvec){
 		class mono newMono;
 		newMono.allocSupp(Polysys.polynomial[0].dimVar);
 		for (int i=0; i<sup.idx.size();i++){
-			for(int j=0; j<binvec.size(); j++){
-				if(binvec[j] == sup.idx[i]){
-					sup.val[i] = 1;
-					break;
-				}	
+			if(flags.isBinary(sup.idx[i])){
+				sup.val[i] = 1;
 			}
 			newMono.setSupp(sup.idx[i], sup.val[i]);
 		}
@@ -1487,11 +1476,11 @@ void s3r::eraseBinaryInObj(vector<int> binvec){
 	objPoly.setTypeSize(1,1);
 	objPoly.setDegree();
 	Polysys.polynomial[0].clear();
-	Polysys.polynomial[0] = objPoly;	
+	Polysys.polynomial[0] = std::move(objPoly);	
 	Polysys.layawayObjConst();
 }
 
-void s3r::eraseSquareOneInObj(vector<int> Sqvec){
+void s3r::eraseSquareOneInObj(const class VarFlags & flags){
 	list<mono>::iterator bite = Polysys.polynomial[0].monoList.begin();
 	list<mono>::iterator eite = Polysys.polynomial[0].monoList.end();
 	list<mono>::iterator ite;
@@ -1502,11 +1491,8 @@ void s3r::eraseSquareOneInObj(vector<int> Sqvec){
 		class mono newMono;
 		newMono.allocSupp(Polysys.polynomial[0].dimVar);
 		for (int i=0; i<sup.idx.size();i++){
-			for(int j=0; j<Sqvec.size(); j++){
-				if(Sqvec[j] == sup.idx[i]){
-					sup.val[i] = (sup.val[i] % 2);
-					break;
-				}	
+			if(flags.isSquareOne(sup.idx[i])){
+				sup.val[i] = (sup.val[i] % 2);
 			}
 			newMono.setSupp(sup.idx[i], sup.val[i]);
 		}
@@ -1522,45 +1508,32 @@ void s3r::eraseSquareOneInObj(vector<int> Sqvec){
 	objPoly.setTypeSize(1,1);
 	objPoly.setDegree();
 	Polysys.polynomial[0].clear();
-	Polysys.polynomial[0] = objPoly;	
+	Polysys.polynomial[0] = std::move(objPoly);	
 	Polysys.layawayObjConst();
 
 }
 void s3r::eraseCompZeroSups(class supSet & czSups){
 	/*NOT IMPLEMENTED */
 }
-void s3r::eraseBinarySups(vector<int> binvec, vector<class supSet> & BsupArray){
+void s3r::eraseBinarySups(const class VarFlags & flags, vector<class supSet> & BsupArray){
 	//cout<<" ***> s3r::eraseBinarySups ---> "<<endl;
 	int sizeP=BsupArray.size();
-	int bsize=binvec.size();
-	int basize;
-	bool flag1 = false;
-	bool flag2 = false;
-	class supSet tmpSupSet;
-	class sup tmpsup;
-	list<class sup>::iterator baIte;
- 	vector<int> baIdx, baVal;
+	#pragma omp parallel for schedule(dynamic)
 	for(int j=1;j<sizeP;j++){
-		tmpSupSet.clear();
+		bool flag2 = false;
+		class supSet tmpSupSet;
+		class sup tmpsup;
+		list<class sup>::iterator baIte;
 		for(baIte = BsupArray[j].begin(); baIte != BsupArray[j].end(); ++ baIte){
 			tmpsup.clear();
-			baIdx.clear();
-			baVal.clear();
-			(*baIte).getIdxsVals(baIdx, baVal);
-			basize = baIdx.size();
+			int basize = (*baIte).idx.size();
 			for(int baidx = 0; baidx < basize; baidx++){
-				for(int i=0;i<bsize;i++){
-					if(baIdx[baidx] == binvec[i]){
-						tmpsup.push(binvec[i], 1);
-						flag1 = true;
-						flag2 = true;
-						break;
-					}
-				}
-				if(flag1 == false){
-					tmpsup.push(baIdx[baidx], baVal[baidx]);	
+				int v = (*baIte).idx[baidx];
+				if(flags.isBinary(v)){
+					tmpsup.push(v, 1);
+					flag2 = true;
 				}else{
-					flag1 = false;
+					tmpsup.push(v, (*baIte).val[baidx]);	
 				}
 			}
 			tmpSupSet.pushSup(tmpsup);
@@ -1574,15 +1547,12 @@ void s3r::eraseBinarySups(vector<int> binvec, vector<class supSet> & BsupArray){
 			//cout << "after "<< endl;
 			//BsupArray[j].disp();
 		}
-		flag2 = false;
 	}
 }
-void s3r::eraseSquareOneSups(vector<int> Sqvec, vector<class supSet> & BsupArray){
+void s3r::eraseSquareOneSups(const class VarFlags & flags, vector<class supSet> & BsupArray){
 	//cout<<" ***> s3r::eraseSquareOneSups ---> "<<endl;
 	int sizeP=BsupArray.size();
-	int Sqsize=Sqvec.size();
 	int basize, val;
-	bool flag1 = false;
 	bool flag2 = false;
 	class supSet tmpSupSet;
 	class sup tmpsup;
@@ -1597,22 +1567,13 @@ void s3r::eraseSquareOneSups(vector<int> Sqvec, vector<class supSet> & BsupArray
 			(*baIte).getIdxsVals(baIdx, baVal);
 			basize = baIdx.size();
 			for(int baidx = 0; baidx < basize; baidx++){
-				for(int i=0;i<Sqsize;i++){
-					if(baIdx[baidx] == Sqvec[i]){
-						val = baVal[baidx] % 2;
-						//cout << "val = " << val << endl;
-						//cout << "idx = " << Sqvec[i] << endl;
-						tmpsup.push(Sqvec[i], val);
-						flag1 = true;
-						flag2 = true;
-						break;
-					}
-				}
-				if(flag1 == false){
-					tmpsup.push(baIdx[baidx], baVal[baidx]);	
+				if(flags.isSquareOne(baIdx[baidx])){
+					val = baVal[baidx] % 2;
+					tmpsup.push(baIdx[baidx], val);
+					flag2 = true;
 				}else{
-					flag1 = false;
-				}	
+					tmpsup.push(baIdx[baidx], baVal[baidx]);	
+				}
 			}
 			tmpSupSet.pushSup(tmpsup);
 		}
@@ -1755,21 +1716,24 @@ void s3r::reduceSupSets(class supsetSet & BasicSupports, class supSet & allNzSup
     int Csize = ABSsize-size;
     
     vector<vector<int> > checkList(Csize);
-    class supSet bSupSet;
     int bsize, tempsize, glsize;
     
     class supSet2 A(Polysys.dimvar());
     list<class sup>::iterator SupIte, SupRIte, SupWIte;
     
+    // hash membership in Fe instead of a linear doesExist per basis support
+    class SupportArena FeArena;
+    FeArena.assign(Fe.supList);
+    FeArena.buildIndex();
     int oldAsize = 0;
     for(int i=0;i<Csize;i++){
-        bSupSet=BasicSupports.supsetArray[i+size];
+        class supSet & bSupSet = BasicSupports.supsetArray[i+size];
         SupIte=bSupSet.begin();
         bsize=bSupSet.size();
         checkList[i].resize(bsize, 1);
         oldAsize += bsize;
         for(int j=0;j<bsize;j++){
-            if(!Fe.doesExist(*SupIte)){
+            if(!FeArena.contains(*SupIte)){
                 A.addSup(i, j, (*SupIte));
             }
             ++SupIte;
@@ -1886,9 +1850,10 @@ void get_subjectto_polys_and_basups(
         /* IN */  class polysystem & polysys, vector<list<int> > BaIndices, vector<class supSet> & basups, int stsize,
         /* OUT */ vector<class poly_info> & polyinfo_st, vector<class bass_info> & bassinfo_st) {
     
-    int bdim;
-    list<int>::iterator lit;
+    #pragma omp parallel for schedule(dynamic)
     for(int i=1;i<stsize+1;i++){
+        int bdim;
+        list<int>::iterator lit;
         initialize_polyinfo(polysys, i, polyinfo_st[i-1]);
 
         bdim = BaIndices[i].size();
@@ -2234,16 +2199,18 @@ void get_allsups_in_momentmatrix(int dimvar, int mmsize, vector<class bass_info>
 // BaIndices[i]: list<int> containing the variable indices for the i-th localizing matrix block
 //                it is generated by the clique/maximal sparsity structure detection e.g. gen_basisindices
 void get_momentmatrix_basups(class polysystem & polysys, vector<list<int> > BaIndices, vector<class supSet> & basups, vector<class bass_info> & bassinfo_mm) {
-    int bdim;
-    list<int>::iterator lit;
     int mmsize = basups.size() - polysys.numsys();
+    int numSys = polysys.numsys();
     // cout << "  mmsize: " << mmsize << "   from basups.size()=" << basups.size() << " - polsys.numsys()=" << polysys.numsys() << endl;
     // cout << "  bassinfo_mm size: " << bassinfo_mm.size() << endl;
     // cout << "  BaIndices size: " << BaIndices.size() << endl;
+    #pragma omp parallel for schedule(dynamic)
     for(int i=0;i<mmsize;i++){
+        int bdim;
+        list<int>::iterator lit;
         bdim = BaIndices[i].size();
         bassinfo_mm[i].dim = bdim;
-        bassinfo_mm[i].deg = basups[i+polysys.numsys()].deg();
+        bassinfo_mm[i].deg = basups[i+numSys].deg();
         bassinfo_mm[i].alloc_pattern(bdim);
         
         bdim = 0;
@@ -2252,7 +2219,7 @@ void get_momentmatrix_basups(class polysystem & polysys, vector<list<int> > BaIn
             bassinfo_mm[i].pattern[bdim] = (*lit);
             bdim++;
         }
-        initialize_spvecs(basups[i+polysys.numsys()], bassinfo_mm[i].sup);
+        initialize_spvecs(basups[i+numSys], bassinfo_mm[i].sup);
     }
 }
 
@@ -2261,51 +2228,56 @@ void get_poly_a_bass_info(
         const int mat_size,
         /* OUT */ vector<class poly_info> & polyinfo, vector<class spvec_array> & bassinfo){
     
-    int no_poly = 0;
- 
-    initialize_polyinfo(polysys, 0, polyinfo[no_poly]);
-    no_poly++;
-    for(int i=1;i<polysys.numsys();i++){
+    // Fix the output position of every block first (equalities, 1x1 inequalities,
+    // 1x1 and larger moment matrices, larger inequalities, SDP constraints), then
+    // fill the positions in parallel. src[k] >= 0 is a constraint, -1-j moment matrix j.
+    int numSys = polysys.numsys();
+    int mmsize = mmBaSupVect.size();
+    vector<int> src;
+    src.reserve(mat_size);
+    src.push_back(0);
+    for(int i=1;i<numSys;i++){
         if(polysys.polyTypeCone(i)==EQU){
-            initialize_polyinfo(polysys, i, polyinfo[no_poly]);
-            initialize_spvecs(BaSupVect[i], bassinfo[no_poly]);
-            no_poly++;
+            src.push_back(i);
         }
     }
-    for(int i=1;i<polysys.numsys();i++){
+    for(int i=1;i<numSys;i++){
         if(polysys.polyTypeCone(i)==INE && BaSupVect[i].size()==1){
-            initialize_polyinfo(polysys, i, polyinfo[no_poly]);
-            initialize_spvecs(BaSupVect[i], bassinfo[no_poly]);
-            no_poly++;
+            src.push_back(i);
         }
     }
-    int mmsize=mmBaSupVect.size();
     for(int i=0;i<mmsize;i++){
         if(mmBaSupVect[i].size() == 1){
-            polyinfo[no_poly].typeCone = -999;
-            initialize_spvecs(mmBaSupVect[i], bassinfo[no_poly]);
-            no_poly++;
+            src.push_back(-1-i);
         }
     }
     for(int i=0;i<mmsize;i++){
         if(mmBaSupVect[i].size() > 1){
-            polyinfo[no_poly].typeCone = -999;
-            initialize_spvecs(mmBaSupVect[i], bassinfo[no_poly]);
-            no_poly++;
+            src.push_back(-1-i);
         }
     }
-    for(int i=1;i<polysys.numsys();i++){
+    for(int i=1;i<numSys;i++){
         if(polysys.polyTypeCone(i)==INE && BaSupVect[i].size()>1){
-            initialize_polyinfo(polysys, i, polyinfo[no_poly]);
-            initialize_spvecs(BaSupVect[i], bassinfo[no_poly]);
-            no_poly++;
+            src.push_back(i);
         }
     }
-    for(int i=1;i<polysys.numsys();i++){
+    for(int i=1;i<numSys;i++){
         if(polysys.polyTypeCone(i)==SDP){
-            initialize_polyinfo(polysys, i, polyinfo[no_poly]);
-            initialize_spvecs(BaSupVect[i], bassinfo[no_poly]);
-            no_poly++;
+            src.push_back(i);
+        }
+    }
+    int numBlocks = src.size();
+    #pragma omp parallel for schedule(dynamic)
+    for(int k=0;k<numBlocks;k++){
+        int i = src[k];
+        if(i == 0){
+            initialize_polyinfo(polysys, 0, polyinfo[k]);
+        }else if(i > 0){
+            initialize_polyinfo(polysys, i, polyinfo[k]);
+            initialize_spvecs(BaSupVect[i], bassinfo[k]);
+        }else{
+            polyinfo[k].typeCone = -999;
+            initialize_spvecs(mmBaSupVect[-1-i], bassinfo[k]);
         }
     }
 }
@@ -2455,21 +2427,13 @@ void initialize_polyinfo(/*IN*/class polysystem & polysys, int nop, /*OUT*/class
     }
 }
 
+// pMat holds only the diagonal of the scaling matrix (dimvar entries)
 void rescale_sol(int dimvar, vector<double> & pMat, vector<double> & bVec, double * & sol){
-    vector<double> yyy(dimvar);
-    for(int i=0; i<dimvar; i++){
-        yyy[i] = sol[i];
-    }
-
     for(int i=0;i<dimvar;i++){
-        sol[i]=0.0;
-        for(int j=0;j<dimvar;j++){
-            if(pMat[i*dimvar+j] != 0.0 ){
-                sol[i] += yyy[j]*pMat[i*dimvar+j];
-            }
-        }
-        if(pMat[i*dimvar+i] != 0.0){
-            sol[i] -= bVec[i];///pMat[i*dimvar+i];
+        if(pMat[i] != 0.0){
+            sol[i] = sol[i]*pMat[i] - bVec[i];
+        }else{
+            sol[i] = 0.0;
         }
     }
 }
@@ -2677,6 +2641,8 @@ s3r :: s3r(){
     this->timedata1.resize(10, 0);
     this->timedata.clear();
     this->timedata.resize(21, 0);
+    this->rssdata.assign(21, 0);
+    this->peakdata.assign(21, 0);
 }
 
 void conversion_part1(
@@ -2688,16 +2654,16 @@ void conversion_part1(
     if(sr.param.detailedInfFile.empty() == false){
         sr.param.write_parameters(sr.param.detailedInfFile);
     }
-    sr.timedata1[0] = (double)clock();
+    sr.timedata1[0] = metrics::wall_seconds();
     if(sr.param.detailedInfFile.empty() == false){
         sr.write_pop(0, sr.param.detailedInfFile);
     }
-    sr.timedata1[1] = (double)clock();
+    sr.timedata1[1] = metrics::wall_seconds();
     blen = sr.Polysys.dimvar();
     mlen = sr.Polysys.dimvar();
     sr.param.scalingSW = 0; // Our implementation can't handle scaling in the same way
     
-    sr.timedata1[2] = (double)clock();
+    sr.timedata1[2] = metrics::wall_seconds();
     //sr.Polysys.writePolynomials();
 	int tf = sr.Polysys.checkBMI();
 	if(tf == 1){
@@ -2741,10 +2707,7 @@ void conversion_part1(
         //eliminate constant from objective function
         sr.Polysys.layawayObjConst();
         //set permutation matrix and constant vector
-        permmatrix.resize(mlen, 0);
-        for(int j=0;j<sr.Polysys.dimvar();j++){
-            permmatrix[j]=1.0;
-        }
+        permmatrix.assign(mlen, 1.0);
         bvect.resize(blen, 0);
         slen = sr.Polysys.numSys;
         scalevalue.resize(slen, 1);
@@ -2753,29 +2716,29 @@ void conversion_part1(
         }
     }
     
-    sr.timedata1[3] = (double)clock();
+    sr.timedata1[3] = metrics::wall_seconds();
 
     //get data of objective function' constant
     objconst = sr.Polysys.objConst;
-    sr.timedata1[4] = (double)clock();
+    sr.timedata1[4] = metrics::wall_seconds();
     
     //perturbate objective function.
     if( sr.param.perturbation > 1.0E-12 ){
         sr.Polysys.perturbObjPoly(3201, sr.param.perturbation);
     }
-    sr.timedata1[5] = (double)clock();
+    sr.timedata1[5] = metrics::wall_seconds();
     
     if(fabs(sr.param.eqTolerance) > EPS){
         sr.Polysys.relax1EqTo2Ineqs(sr.param.eqTolerance);
     }
-    sr.timedata1[6] = (double)clock();
+    sr.timedata1[6] = metrics::wall_seconds();
     
     if(sr.param.detailedInfFile.empty() == false){
         if(sr.param.scalingSW == 1 || abs(sr.param.eqTolerance) > EPS || abs(sr.param.perturbation) > EPS){
             sr.write_pop(1, sr.param.detailedInfFile);
         }
     }
-    sr.timedata1[7] = (double)clock();
+    sr.timedata1[7] = metrics::wall_seconds();
     //system("top -b -n 1 | grep MATLAB | head -1 |awk '{printf(\"memory = %s\\n\"), $6}' ");
     //cout << "***End of conversion_part1" << endl;
     sr.timedata1[8] = sr.timedata1[7];
@@ -3062,11 +3025,11 @@ void addPolynomial(class s3r & sr, int& i, const int& pwidth, const vector<int>&
         if (j == numnew - 1) { // if it is the last polynomial formed from polynomial[i], take polynomial[i]'s place
             //cout << "       Add to position " << i << endl;
             bindToNew[i].push_back(i);
-            sr.Polysys.polynomial[i] = new_poly; 
+            sr.Polysys.polynomial[i] = std::move(new_poly); 
         } else {
             //cout << "       Add to position " << sr.Polysys.polynomial.size() << endl;
             bindToNew[i].push_back(sr.Polysys.polynomial.size());
-            sr.Polysys.polynomial.push_back(new_poly);
+            sr.Polysys.polynomial.push_back(std::move(new_poly));
         }
         // printPolynomial(new_poly, "Poly " + to_string(i) +"." + to_string(j+1)); // print new poly
     }
@@ -3083,14 +3046,21 @@ void addPolynomialGround(class s3r & sr, int& i, const int& pwidth, const vector
     } 
     int numnew = (gndOff[i+1] - gndOff[i]) / pwidth;
     cout << "   [GROUND] constraint " << i << " becomes " << numnew << " constraints." << endl;
+    if (numnew == 0) return;
+
+    // Take the template out of the system once and keep its monomials apart, so
+    // each grounding copies only the header instead of the whole monomial list
+    class poly tmpl = std::move(sr.Polysys.polynomial[i]);
+    list<mono> tmplMonos;
+    tmplMonos.swap(tmpl.monoList);
     
     for (int j = 0; j < numnew; j++){
-        class poly new_poly = sr.Polysys.polynomial[i]; 
+        class poly new_poly = tmpl; 
         int curidx = gndOff[i] + pwidth * j; 
         int numadd = 0;
         double constantContribution = 0.0;  // Accumulate constants from fully evaluated monomials
 
-        if (new_poly.monoList.empty()){
+        if (tmplMonos.empty()){
             // Handle beenZero case (same as original - no substitution needed here)
             for (int s = 0; s < new_poly.beenZero.size(); s++){
                 for (int t = 0; t < sr.bindices.size(); t++){
@@ -3126,7 +3096,7 @@ void addPolynomialGround(class s3r & sr, int& i, const int& pwidth, const vector
         } else {
             // Main case: iterate through monomials and handle substitution
             vector<mono> newMonoList;  // Build new monomial list
-            for (auto& mono : new_poly.monoList){
+            for (const auto& mono : tmplMonos){
                 // Skip constant monomials
                 if (mono.supIdx.empty()) {
                     newMonoList.push_back(mono);
@@ -3192,7 +3162,7 @@ void addPolynomialGround(class s3r & sr, int& i, const int& pwidth, const vector
                             expectMap[origVarIdx].insert(atomID);
                         }
                         // Add reduced monomial to new list
-                        newMonoList.push_back(result.reducedMono);
+                        newMonoList.push_back(std::move(result.reducedMono));
                     }
                     if (numadd >= pwidth) break;
                 } else {
@@ -3256,7 +3226,7 @@ void addPolynomialGround(class s3r & sr, int& i, const int& pwidth, const vector
                                 expectMap[origVarIdx].insert(atomID);
                             }
                             // Add reduced monomial to new list
-                            newMonoList.push_back(result.reducedMono);
+                            newMonoList.push_back(std::move(result.reducedMono));
                         }
                         if (numadd >= pwidth) break;
                     }
@@ -3283,7 +3253,8 @@ void addPolynomialGround(class s3r & sr, int& i, const int& pwidth, const vector
                 }
             }
 
-            vector<mono> cleanedMonoList;
+            // Replace monomial list with the nonzero monomials of the new one
+            new_poly.monoList.clear();
             for (auto& m : newMonoList) {
                 bool hasNonZeroCoef = false;
                 for (int c = 0; c < m.Coef.size(); c++) {
@@ -3293,20 +3264,14 @@ void addPolynomialGround(class s3r & sr, int& i, const int& pwidth, const vector
                     }
                 }
                 if (hasNonZeroCoef) {
-                    cleanedMonoList.push_back(m);
+                    new_poly.monoList.push_back(std::move(m));
                 }
             }
-            
-            // Replace monomial list with new one
-            new_poly.monoList.clear();
-            for (auto& m : cleanedMonoList) {
-                new_poly.monoList.push_back(m);
-            }
             // update noTerms to match the new monoList size
-            new_poly.noTerms = cleanedMonoList.size();
+            new_poly.noTerms = new_poly.monoList.size();
             // recalculate degree
             new_poly.degree = 0;
-            for (auto& m : cleanedMonoList) {
+            for (auto& m : new_poly.monoList) {
                 int monoDegree = 0;
                 for (int exp : m.supVal) {
                     monoDegree += exp;
@@ -3319,15 +3284,276 @@ void addPolynomialGround(class s3r & sr, int& i, const int& pwidth, const vector
         // Add new polynomial to polynomial list
         if (j == numnew - 1) {
             bindToNew[i].push_back(i);
-            sr.Polysys.polynomial[i] = new_poly;
+            sr.Polysys.polynomial[i] = std::move(new_poly);
         } else {
             bindToNew[i].push_back(sr.Polysys.polynomial.size());
-            sr.Polysys.polynomial.push_back(new_poly);
+            sr.Polysys.polynomial.push_back(std::move(new_poly));
         }
         // printPolynomial(new_poly, "Poly " + to_string(i) +"." + to_string(j+1)); // print new poly
     }
 }
 
+// Presolve of the grounded system (run before WL)
+//   Interval propagation over the box [lo, up]: for every constraint and every
+//   atom v occurring exactly once, linearly, in a monomial c*v*M (M the product
+//   of the other atoms of that monomial), the remaining terms bound c*v*M and
+//   hence v. Products are only divided through when v and M are nonnegative.
+//   Sweeps repeat until no bound moves (fixpoint). Then
+//     - atoms with lo == up are substituted as constants (and treated as observed)
+//     - constraints whose interval is nonnegative (INE) or identically zero (EQU)
+//       on the tightened box are dropped
+//     - tightened bounds are kept as explicit linear constraints, the same way
+//       the bounded atom is encoded
+//   Returns false, after printing the offending constraint, if the system is
+//   infeasible on the box.
+static const double PRESOLVE_TOL = 1.0e-9;
+static const int    PRESOLVE_MAX_SWEEPS = 100;
+
+struct presolve_interval { double lo, hi; };
+
+static presolve_interval presolve_mul(presolve_interval a, presolve_interval b) {
+    double p[4] = { a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi };
+    return { *std::min_element(p, p + 4), *std::max_element(p, p + 4) };
+}
+
+static presolve_interval presolve_pow(presolve_interval a, int e) {
+    if (e == 1) return a;
+    double l = std::pow(a.lo, e), h = std::pow(a.hi, e);
+    if (e % 2 == 0 && a.lo < 0.0 && a.hi > 0.0) return { 0.0, std::max(l, h) };
+    return { std::min(l, h), std::max(l, h) };
+}
+
+// Interval of a monomial, optionally leaving out one atom
+static presolve_interval presolve_mono(const mono& m, const std::vector<double>& lo, const std::vector<double>& up, int skip = -1) {
+    double c = m.Coef.empty() ? 0.0 : m.Coef[0];
+    presolve_interval r = { c, c };
+    for (int k = 0; k < (int)m.supIdx.size(); k++) {
+        int v = m.supIdx[k];
+        if (v == skip) continue;
+        r = presolve_mul(r, presolve_pow({ lo[v], up[v] }, m.supVal[k]));
+    }
+    return r;
+}
+
+static presolve_interval presolve_poly(const poly& p, const std::vector<double>& lo, const std::vector<double>& up) {
+    presolve_interval r = { 0.0, 0.0 };
+    for (const mono& m : p.monoList) {
+        presolve_interval mi = presolve_mono(m, lo, up);
+        r.lo += mi.lo;
+        r.hi += mi.hi;
+    }
+    return r;
+}
+
+static bool presolve_violated(const poly& p, presolve_interval r) {
+    if (p.typeCone == EQU) return r.lo > PRESOLVE_TOL || r.hi < -PRESOLVE_TOL;
+    return r.hi < -PRESOLVE_TOL;
+}
+
+static bool presolve_redundant(const poly& p, presolve_interval r) {
+    if (p.typeCone == EQU) return r.lo >= -PRESOLVE_TOL && r.hi <= PRESOLVE_TOL;
+    return p.typeCone == INE && r.lo >= -PRESOLVE_TOL;
+}
+
+static bool presolve_linear(const poly& p) {
+    for (const mono& m : p.monoList)
+        if (m.supIdx.size() > 1 || (m.supIdx.size() == 1 && m.supVal[0] != 1)) return false;
+    return true;
+}
+
+// Tighten the bounds of the atoms of one constraint; returns true if a bound moved
+static bool presolve_propagate(const poly& p, std::vector<double>& lo, std::vector<double>& up) {
+    if (p.typeCone != INE && p.typeCone != EQU) return false;
+    bool moved = false;
+    for (const mono& m : p.monoList) {
+        for (int k = 0; k < (int)m.supIdx.size(); k++) {
+            int v = m.supIdx[k];
+            if (m.supVal[k] != 1) continue;
+            // v must not occur in any other monomial of p
+            bool single = true;
+            for (const mono& o : p.monoList) {
+                if (&o == &m) continue;
+                if (std::find(o.supIdx.begin(), o.supIdx.end(), v) != o.supIdx.end()) { single = false; break; }
+            }
+            if (!single) continue;
+
+            // p = c*v*M + r, with cM = c*M
+            presolve_interval cM = presolve_mono(m, lo, up, v);
+            presolve_interval r = { 0.0, 0.0 };
+            for (const mono& o : p.monoList) {
+                if (&o == &m) continue;
+                presolve_interval oi = presolve_mono(o, lo, up);
+                r.lo += oi.lo;
+                r.hi += oi.hi;
+            }
+            // need cM*v in [-r.hi, +inf) (INE) or [-r.hi, -r.lo] (EQU)
+            double need_lo = -r.hi;
+            double need_hi = (p.typeCone == EQU) ? -r.lo : INFINITY;
+
+            double new_lo = lo[v], new_hi = up[v];
+            if (m.supIdx.size() == 1) {
+                double c = cM.lo; // constant coefficient
+                if (c > PRESOLVE_TOL) {
+                    new_lo = std::max(new_lo, need_lo / c);
+                    if (std::isfinite(need_hi)) new_hi = std::min(new_hi, need_hi / c);
+                } else if (c < -PRESOLVE_TOL) {
+                    new_hi = std::min(new_hi, need_lo / c);
+                    if (std::isfinite(need_hi)) new_lo = std::max(new_lo, need_hi / c);
+                }
+            } else if (lo[v] >= 0.0 && cM.lo >= 0.0) {
+                // cM*v with cM in [cM.lo, cM.hi] >= 0 and v >= 0
+                if (need_lo > 0.0 && cM.hi > 0.0) new_lo = std::max(new_lo, need_lo / cM.hi);
+                if (std::isfinite(need_hi) && cM.lo > PRESOLVE_TOL) new_hi = std::min(new_hi, need_hi / cM.lo);
+            } else if (lo[v] >= 0.0 && cM.hi <= 0.0) {
+                // cM*v = -(|cM|*v) with |cM| in [-cM.hi, -cM.lo]
+                if (need_lo > 0.0) continue; // nonpositive term cannot reach a positive target; left to the violation check
+                if (-cM.hi > PRESOLVE_TOL) new_hi = std::min(new_hi, -need_lo / -cM.hi);
+                if (std::isfinite(need_hi) && need_hi < 0.0 && -cM.lo > 0.0) new_lo = std::max(new_lo, -need_hi / -cM.lo);
+            }
+            if (new_lo > lo[v] + PRESOLVE_TOL) { lo[v] = new_lo; moved = true; }
+            if (new_hi < up[v] - PRESOLVE_TOL) { up[v] = new_hi; moved = true; }
+        }
+    }
+    return moved;
+}
+
+static bool presolve_grounded_system(class s3r & sr, std::vector<double>& lo, std::vector<double>& up,
+                                     std::vector<double>& observedValueById, int numVars) {
+    const int numPolys = (int)sr.Polysys.polynomial.size();
+    const std::vector<double> lo0 = lo, up0 = up;
+
+    // 1. Interval propagation to a fixpoint
+    int sweeps = 0;
+    bool moved = true;
+    while (moved && sweeps < PRESOLVE_MAX_SWEEPS) {
+        moved = false;
+        sweeps++;
+        for (int i = 1; i < numPolys; i++) {
+            const poly& p = sr.Polysys.polynomial[i];
+            if (presolve_violated(p, presolve_poly(p, lo, up))) {
+                cout << "[PRESOLVE] Infeasible: constraint " << i << " cannot be satisfied on the box" << endl;
+                return false;
+            }
+            if (presolve_propagate(p, lo, up)) moved = true;
+        }
+        for (int v = 0; v < numVars; v++) {
+            if (lo[v] > up[v] + PRESOLVE_TOL) {
+                cout << "[PRESOLVE] Infeasible: empty interval for atom " << v
+                     << " [" << lo[v] << ", " << up[v] << "]" << endl;
+                return false;
+            }
+        }
+    }
+
+    // 2. Substitute fixed atoms
+    std::vector<char> used(numVars, 0);
+    for (const auto& p : sr.Polysys.polynomial)
+        for (const mono& m : p.monoList)
+            for (int v : m.supIdx) if (v < numVars) used[v] = 1;
+    std::vector<char> fixed(numVars, 0);
+    int numFixed = 0, numTightened = 0;
+    for (int v = 0; v < numVars; v++) {
+        bool is_obs = (v < (int)observedValueById.size()) && !std::isnan(observedValueById[v]);
+        if (is_obs || !used[v]) continue;
+        if (up[v] - lo[v] <= PRESOLVE_TOL) {
+            fixed[v] = 1;
+            up[v] = lo[v];
+            if (v >= (int)observedValueById.size()) observedValueById.resize(v + 1, NAN);
+            observedValueById[v] = lo[v];
+            numFixed++;
+        } else if (lo[v] > lo0[v] + PRESOLVE_TOL || up[v] < up0[v] - PRESOLVE_TOL) {
+            numTightened++;
+        }
+    }
+    if (numFixed > 0) {
+        for (auto& p : sr.Polysys.polynomial) {
+            std::vector<mono> oldMonos(p.monoList.begin(), p.monoList.end());
+            p.monoList.clear();
+            p.noTerms = 0;
+            for (auto& m : oldMonos) {
+                mono newMono;
+                newMono.allocCoef(1);
+                newMono.Coef[0] = m.Coef[0];
+                for (int kk = 0; kk < (int)m.supIdx.size(); kk++) {
+                    int v = m.supIdx[kk];
+                    if (v < numVars && fixed[v]) {
+                        newMono.Coef[0] *= std::pow(lo[v], m.supVal[kk]);
+                    } else {
+                        newMono.supIdx.push_back(v);
+                        newMono.supVal.push_back(m.supVal[kk]);
+                    }
+                }
+                p.addMono(newMono);
+            }
+        }
+        for (auto& bl : sr.bindices)
+            bl.remove_if([&](int v) { return v < numVars && fixed[v]; });
+    }
+
+    // 3. Drop linear constraints implied by the bound rows added in step 4.
+    // Only the tightened sides become rows, so redundancy is judged on that
+    // box alone; a nonlinear constraint keeps its localizing matrix even when
+    // the box implies it, since the relaxation does not see the box there.
+    std::vector<double> row_lo(numVars, -INFINITY), row_up(numVars, INFINITY);
+    for (int v = 0; v < numVars; v++) {
+        if (lo[v] > lo0[v] + PRESOLVE_TOL) row_lo[v] = lo[v];
+        if (up[v] < up0[v] - PRESOLVE_TOL) row_up[v] = up[v];
+    }
+    std::vector<poly> kept_polys;
+    std::vector<std::list<int>> kept_bindices;
+    kept_polys.push_back(std::move(sr.Polysys.polynomial[0]));
+    kept_bindices.push_back(std::move(sr.bindices[0]));
+    for (int i = 1; i < numPolys; i++) {
+        poly& p = sr.Polysys.polynomial[i];
+        presolve_interval r = presolve_poly(p, lo, up);
+        if (presolve_violated(p, r)) {
+            cout << "[PRESOLVE] Infeasible: constraint " << i << " cannot be satisfied after substitution" << endl;
+            return false;
+        }
+        if (presolve_linear(p) && presolve_redundant(p, presolve_poly(p, row_lo, row_up))) continue;
+        kept_polys.push_back(std::move(p));
+        kept_bindices.push_back(std::move(sr.bindices[i]));
+    }
+    int numDropped = numPolys - (int)kept_polys.size();
+
+    // 4. Keep the tightened bounds as linear constraints
+    for (int v = 0; v < numVars; v++) {
+        if (fixed[v]) continue;
+        for (int side = 0; side < 2; side++) {
+            bool isLower = (side == 0);
+            if (isLower ? !(lo[v] > lo0[v] + PRESOLVE_TOL) : !(up[v] < up0[v] - PRESOLVE_TOL)) continue;
+            class poly boundPoly;
+            boundPoly.setNoSys(kept_polys.size());
+            boundPoly.setDimVar(numVars);
+            boundPoly.setTypeSize(INE, 1);
+            boundPoly.degree = 1;
+            class mono varMono;
+            varMono.allocCoef(1);
+            varMono.Coef[0] = isLower ? 1.0 : -1.0;
+            varMono.supIdx.push_back(v);
+            varMono.supVal.push_back(1);
+            boundPoly.addMono(varMono);
+            class mono constMono;
+            constMono.allocCoef(1);
+            constMono.Coef[0] = isLower ? -lo[v] : up[v];
+            boundPoly.addMono(constMono);
+            kept_polys.push_back(boundPoly);
+            kept_bindices.push_back(list<int>(1, v));
+        }
+    }
+    for (int i = numPolys; i < (int)sr.bindices.size(); i++)
+        kept_bindices.push_back(std::move(sr.bindices[i]));
+
+    cout << "[PRESOLVE] " << sweeps << " sweep(s): " << numFixed << " atoms fixed, " << numTightened
+         << " atoms tightened, " << numDropped << " constraints dropped, "
+         << (kept_polys.size() - (numPolys - numDropped)) << " bound constraints added" << endl;
+
+    sr.Polysys.polynomial = std::move(kept_polys);
+    sr.bindices           = std::move(kept_bindices);
+    sr.Polysys.numSys     = (int)sr.Polysys.polynomial.size();
+    return true;
+}
+
 /////////
 // Helper functions for WL Fingerprint Calculation (used for identifying equivalence in the constraint set)
 /////////
@@ -3346,153 +3572,250 @@ static inline size_t wl_hash_double(double d) {
 }
 
 
-// Hash one monomial from variable v's perspective
-//    The result is the same regardless of the internal order of
-//    supIdx / supVal, because we sort neighbor contributions.
-static size_t wl_hash_mono_view(const mono& m, int v, const std::vector<size_t>& label) {
-    double coef = m.Coef.empty() ? 0.0 : m.Coef[0];
-    size_t h = wl_hash_double(coef);
-
-    // Walk through the sparse support
-    int v_exp = 0;
-    std::vector<size_t> neighbor_hashes;
+// Flat (CSR) view of the polynomial system used by the WL refinement.
+//   poly p owns monomials [mono_ptr[p], mono_ptr[p+1])
+//   mono m owns terms     [term_ptr[m], term_ptr[m+1]) of (term_var, term_exp)
+//   var  v appears in the polys var_polys[var_ptr[v] .. var_ptr[v+1])
+struct wl_flat_system {
+    std::vector<int>    poly_type;
+    std::vector<int>    mono_ptr;
+    std::vector<size_t> mono_coef_hash;
+    std::vector<int>    term_ptr;
+    std::vector<int>    term_var;
+    std::vector<int>    term_exp;
+    std::vector<int>    var_ptr;
+    std::vector<int>    var_polys;
+};
 
-    for (int k = 0; k < (int)m.supIdx.size(); k++) {
-        int var = m.supIdx[k];
-        int exp = m.supVal[k];
-        if (var == v) {
-            v_exp = exp;
-        } else {
-            // pair (label[var], exp) → one hash contribution
-            size_t nh = wl_hash_combine(label[var], std::hash<int>{}(exp));
-            neighbor_hashes.push_back(nh);
+static void wl_build_flat_system(const std::vector<poly>& polys, int numVars, wl_flat_system& fs) {
+    const int numPolys = (int)polys.size();
+    fs.poly_type.resize(numPolys);
+    fs.mono_ptr.assign(1, 0);
+    fs.term_ptr.assign(1, 0);
+    std::vector<int> deg(numVars + 1, 0);
+    std::vector<int> last_seen(numVars, -1);
+
+    for (int p = 0; p < numPolys; p++) {
+        fs.poly_type[p] = polys[p].typeCone;
+        for (const mono& m : polys[p].monoList) {
+            fs.mono_coef_hash.push_back(wl_hash_double(m.Coef.empty() ? 0.0 : m.Coef[0]));
+            for (int k = 0; k < (int)m.supIdx.size(); k++) {
+                int var = m.supIdx[k];
+                fs.term_var.push_back(var);
+                fs.term_exp.push_back(m.supVal[k]);
+                if (var >= 0 && var < numVars && last_seen[var] != p) {
+                    last_seen[var] = p;
+                    deg[var + 1]++;
+                }
+            }
+            fs.term_ptr.push_back((int)fs.term_var.size());
+        }
+        fs.mono_ptr.push_back((int)fs.mono_coef_hash.size());
+    }
+
+    // Reverse index: atom_id -> polynomial indices (deduplicated, ascending)
+    for (int v = 0; v < numVars; v++) deg[v + 1] += deg[v];
+    fs.var_ptr = deg;
+    fs.var_polys.resize(fs.var_ptr[numVars]);
+    std::fill(last_seen.begin(), last_seen.end(), -1);
+    for (int p = 0; p < numPolys; p++) {
+        for (int t = fs.term_ptr[fs.mono_ptr[p]]; t < fs.term_ptr[fs.mono_ptr[p + 1]]; t++) {
+            int var = fs.term_var[t];
+            if (var >= 0 && var < numVars && last_seen[var] != p) {
+                last_seen[var] = p;
+                fs.var_polys[deg[var]++] = p;
+            }
         }
     }
-    // Sort so the result doesn't depend on supIdx ordering
-    std::sort(neighbor_hashes.begin(), neighbor_hashes.end());
-
-    h = wl_hash_combine(h, std::hash<int>{}(v_exp));
-    for (size_t nh : neighbor_hashes)
-        h = wl_hash_combine(h, nh);
-
-    return h;
 }
 
-// Hash one full polynomial from variable v's perspective
-static size_t wl_hash_poly_view(const poly& p, int v, const std::vector<size_t>& label) {
-    size_t h = std::hash<int>{}(p.typeCone);
-
-    // Hash every monomial and collect in a vector, then sort
-    // (so insertion order into monoList doesn't matter)
-    std::vector<size_t> mono_hashes;
-    mono_hashes.reserve(p.noTerms);
+// Hash one polynomial from variable v's perspective.
+//    Neighbor and monomial contributions are sorted, so the result does not
+//    depend on the order of supIdx / supVal or of the monoList.
+static size_t wl_hash_poly_view(const wl_flat_system& fs, int p, int v, const std::vector<int>& color,
+                                std::vector<size_t>& mono_hashes, std::vector<size_t>& neighbor_hashes) {
+    mono_hashes.clear();
+    for (int m = fs.mono_ptr[p]; m < fs.mono_ptr[p + 1]; m++) {
+        int v_exp = 0;
+        neighbor_hashes.clear();
+        for (int t = fs.term_ptr[m]; t < fs.term_ptr[m + 1]; t++) {
+            int var = fs.term_var[t];
+            if (var == v) {
+                v_exp = fs.term_exp[t];
+            } else {
+                // pair (color[var], exp) -> one hash contribution
+                int c = (var >= 0 && var < (int)color.size()) ? color[var] : -1;
+                neighbor_hashes.push_back(wl_hash_combine(std::hash<int>{}(c), std::hash<int>{}(fs.term_exp[t])));
+            }
+        }
+        std::sort(neighbor_hashes.begin(), neighbor_hashes.end());
 
-    for (const mono& m : p.monoList) {
-        mono_hashes.push_back(wl_hash_mono_view(m, v, label));
+        size_t h = wl_hash_combine(fs.mono_coef_hash[m], std::hash<int>{}(v_exp));
+        for (size_t nh : neighbor_hashes) h = wl_hash_combine(h, nh);
+        mono_hashes.push_back(h);
     }
     std::sort(mono_hashes.begin(), mono_hashes.end());
 
+    size_t h = std::hash<int>{}(fs.poly_type[p]);
     for (size_t mh : mono_hashes) h = wl_hash_combine(h, mh);
-
     return h;
 }
 
 
-// Full 
-static std::vector<size_t> compute_wl_fingerprints(const std::vector<poly>& polys, int numVars, const std::vector<double>& obsValue) {
-    const size_t OBS_SEED = 0xDEADBEEF12345678ULL;
-    const size_t UNK_SEED = 0xCAFEBABE87654321ULL;
+// Color refinement (1-WL) over the variable / polynomial incidence.
+//   Colors are small integers; a variable's color only splits when the
+//   signature (multiset of poly views) differs from its class mates.
+//   Worklist: only variables sharing a polynomial with a variable whose
+//   color changed in the previous round are rehashed, everything else keeps
+//   its cached signature. When a class splits, its largest part keeps the
+//   old color so that as few variables as possible are marked changed.
+//   Signatures are computed in parallel; the color assignment is done by
+//   sorting (signature, var) within each class, so the result is thread-count independent.
+static std::vector<int> compute_wl_fingerprints(const std::vector<poly>& polys, int numVars, const std::vector<double>& obsValue) {
     const int MAX_ITER = 50; //if doesn't converge in iter < 5, something probably aint right
 
-    // Build reverse index: atom_id -> polynomial indices (deduplicated)
-    std::vector<std::vector<int>> var_to_polys(numVars);
-    for (int p = 0; p < (int)polys.size(); p++) {
-        std::unordered_set<int> seen;
-        for (const mono& m : polys[p].monoList)
-            for (int var : m.supIdx)
-                if (var >= 0 && var < numVars && seen.insert(var).second)
-                    var_to_polys[var].push_back(p);
-    }
+    wl_flat_system fs;
+    wl_build_flat_system(polys, numVars, fs);
 
-    // Round 0: initial labels
-    std::vector<size_t> label(numVars);
-    for (int v = 0; v < numVars; v++) {
-        bool is_obs = (v < (int)obsValue.size()) && !std::isnan(obsValue[v]);
-        label[v] = is_obs
-            ? wl_hash_combine(OBS_SEED, wl_hash_double(obsValue[v]))
-            : UNK_SEED;
-    }
+    auto is_obs = [&](int v) { return (v < (int)obsValue.size()) && !std::isnan(obsValue[v]); };
 
-    // Helper: canonicalize a raw hash vector into sequential integers 
-    auto canonicalize = [&](const std::vector<size_t>& raw) -> std::vector<size_t> {
-        std::map<size_t, size_t> hash_to_id;
-        size_t next_id = 0;
-        std::vector<size_t> canon(numVars);
+    // Round 0: observed atoms are colored by value, all unknown atoms share one color
+    std::vector<int> color(numVars, 0);
+    int num_colors = 0;
+    {
+        std::map<double, int> value_to_color;
         for (int v = 0; v < numVars; v++) {
-            auto it = hash_to_id.find(raw[v]);
-            if (it == hash_to_id.end()) hash_to_id[raw[v]] = next_id++;
-            canon[v] = hash_to_id[raw[v]];
+            if (!is_obs(v)) continue;
+            double d = obsValue[v];
+            if (d == 0.0) d = 0.0; // -0.0 and 0.0 get the same color
+            auto it = value_to_color.find(d);
+            if (it == value_to_color.end()) it = value_to_color.emplace(d, (int)value_to_color.size() + 1).first;
+            color[v] = it->second;
         }
-        return canon;
-    };
+        num_colors = (int)value_to_color.size() + 1;
+    }
 
-    // Helper: check if two canonical label vectors define the same partition (the mapping old-new is bijection)
-    auto same_partition = [&](const std::vector<size_t>& old_c, const std::vector<size_t>& new_c) -> bool {
-        std::unordered_map<size_t, size_t> fwd, bwd;
-        for (int v = 0; v < numVars; v++) {
-            size_t o = old_c[v], n = new_c[v];
-            auto fit = fwd.find(o);
-            if (fit == fwd.end()) fwd[o] = n;
-            else if (fit->second != n) return false;
-            auto bit = bwd.find(n);
-            if (bit == bwd.end()) bwd[n] = o;
-            else if (bit->second != o) return false;
-        }
-        return true;
-    };
+    // members[c]: the unknown atoms currently colored c (observed atoms are never refined)
+    std::vector<std::vector<int>> members(num_colors);
+    for (int v = 0; v < numVars; v++)
+        if (!is_obs(v)) members[color[v]].push_back(v);
 
-    label = canonicalize(label);  // start from canonical round-0
+    std::vector<size_t> signature(numVars, 0);
+    std::vector<char>   in_dirty(numVars, 0);
+    std::vector<char>   color_touched(num_colors, 0);
+    std::vector<int>    dirty;
+    for (int v = 0; v < numVars; v++)
+        if (!is_obs(v)) dirty.push_back(v);
 
-    for (int iter = 0; iter < MAX_ITER; iter++) {
-        // Compute raw new hashes using current canonical labels
-        std::vector<size_t> new_label(numVars);
-        for (int v = 0; v < numVars; v++) {
-            bool is_obs = (v < (int)obsValue.size()) && !std::isnan(obsValue[v]);
-            if (is_obs) { new_label[v] = label[v]; continue; }
+    std::vector<int> changed;
+    std::vector<int> touched_colors;
+    std::vector<std::pair<size_t, int>> order; // (signature, var)
 
-            std::vector<size_t> poly_hashes;
-            for (int p : var_to_polys[v])
-                poly_hashes.push_back(wl_hash_poly_view(polys[p], v, label));
-            std::sort(poly_hashes.begin(), poly_hashes.end());
+    for (int iter = 0; iter < MAX_ITER; iter++) {
+        // Recompute signatures of the dirty atoms
+        #pragma omp parallel
+        {
+            std::vector<size_t> poly_hashes, mono_hashes, neighbor_hashes;
+            #pragma omp for schedule(dynamic, 64)
+            for (int i = 0; i < (int)dirty.size(); i++) {
+                int v = dirty[i];
+                poly_hashes.clear();
+                for (int k = fs.var_ptr[v]; k < fs.var_ptr[v + 1]; k++)
+                    poly_hashes.push_back(wl_hash_poly_view(fs, fs.var_polys[k], v, color, mono_hashes, neighbor_hashes));
+                std::sort(poly_hashes.begin(), poly_hashes.end());
+
+                size_t h = 0;
+                for (size_t ph : poly_hashes) h = wl_hash_combine(h, ph);
+                signature[v] = h;
+            }
+        }
 
-            size_t h = label[v];
-            for (size_t ph : poly_hashes) h = wl_hash_combine(h, ph);
-            new_label[v] = h;
+        // Only classes holding a dirty atom can split
+        touched_colors.clear();
+        for (int v : dirty) {
+            in_dirty[v] = 0;
+            if (!color_touched[color[v]]) {
+                color_touched[color[v]] = 1;
+                touched_colors.push_back(color[v]);
+            }
         }
+        std::sort(touched_colors.begin(), touched_colors.end());
+
+        changed.clear();
+        for (int c : touched_colors) {
+            color_touched[c] = 0;
+            order.clear();
+            for (int v : members[c]) order.emplace_back(signature[v], v);
+            std::sort(order.begin(), order.end());
+
+            // Split into runs of equal signature; the largest run keeps color c
+            std::vector<std::pair<int,int>> runs; // [begin, end) in order
+            for (int b = 0; b < (int)order.size(); ) {
+                int e = b + 1;
+                while (e < (int)order.size() && order[e].first == order[b].first) e++;
+                runs.emplace_back(b, e);
+                b = e;
+            }
+            if (runs.size() <= 1) continue;
 
-        std::vector<size_t> canon = canonicalize(new_label);
+            int keep = 0;
+            for (int r = 1; r < (int)runs.size(); r++)
+                if (runs[r].second - runs[r].first > runs[keep].second - runs[keep].first) keep = r;
 
-        size_t num_classes = *std::max_element(canon.begin(), canon.end()) + 1;
-        // std::cout << "[WL] Iteration " << (iter+1) << ", distinct labels: " << num_classes << std::endl;
+            std::vector<int> kept;
+            for (int r = 0; r < (int)runs.size(); r++) {
+                if (r == keep) {
+                    for (int i = runs[r].first; i < runs[r].second; i++) kept.push_back(order[i].second);
+                    continue;
+                }
+                int nc = num_colors++;
+                members.emplace_back();
+                color_touched.push_back(0);
+                for (int i = runs[r].first; i < runs[r].second; i++) {
+                    int v = order[i].second;
+                    color[v] = nc;
+                    members[nc].push_back(v);
+                    changed.push_back(v);
+                }
+            }
+            members[c].swap(kept);
+        }
 
-        if (same_partition(label, canon)) {
+        // std::cout << "[WL] Iteration " << (iter+1) << ", distinct labels: " << num_colors << std::endl;
+
+        if (changed.empty()) {
             std::cout << "[WL] Converged after " << (iter+1) << " iteration(s)" << std::endl;
-            return canon;
+            return color;
+        }
+
+        // Next worklist: unknown atoms sharing a polynomial with a recolored atom
+        dirty.clear();
+        for (int v : changed) {
+            for (int k = fs.var_ptr[v]; k < fs.var_ptr[v + 1]; k++) {
+                int p = fs.var_polys[k];
+                for (int t = fs.term_ptr[fs.mono_ptr[p]]; t < fs.term_ptr[fs.mono_ptr[p + 1]]; t++) {
+                    int u = fs.term_var[t];
+                    if (u >= 0 && u < numVars && !in_dirty[u] && !is_obs(u)) {
+                        in_dirty[u] = 1;
+                        dirty.push_back(u);
+                    }
+                }
+            }
         }
-        label = canon;
+        std::sort(dirty.begin(), dirty.end());
     }
 
     std::cout << "[WL] WARNING: hit iteration cap of " << MAX_ITER << std::endl;
-    return label;
+    return color;
 }
 
 
 // Build symmetry map
 //   Returns var_map[v] = representative of v's equivalence class.
-static std::vector<int> build_symmetry_map(const std::vector<size_t>& label, int numVars, const std::vector<double>& obsValue) {
+static std::vector<int> build_symmetry_map(const std::vector<int>& label, int numVars, const std::vector<double>& obsValue) {
     std::vector<int> var_map(numVars);
     std::iota(var_map.begin(), var_map.end(), 0); // identity by default
-    std::unordered_map<size_t, int> label_to_rep;
+    std::unordered_map<int, int> label_to_rep;
 
     for (int v = 0; v < numVars; v++) {
         bool is_obs = (v < (int)obsValue.size()) && !std::isnan(obsValue[v]);
@@ -3517,6 +3840,540 @@ static std::vector<int> build_symmetry_map(const std::vector<size_t>& label, int
 }
 
 
+// Canonical flat form of a polynomial used for duplicate removal.
+//   Coefficients are quantized to 1e-10 (the precision the old %.10f
+//   fingerprint compared at), the (supIdx, supVal) pairs of each monomial are
+//   sorted by variable and the monomials are sorted, so the key depends
+//   neither on monoList order nor on the term order inside a monomial.
+//   The key is packed into ints so it can live in a FlatMonomialMap arena.
+struct poly_dedup_key {
+    std::vector<int> words; // typeCone, then per monomial: quantized coefficient bits (2 ints), term count, sorted pairs
+    size_t hash;
+    const int* packed() const { return words.data(); }
+    int packed_size() const { return (int)words.size(); }
+};
+
+struct poly_dedup_key_hash {
+    size_t operator()(const poly_dedup_key& key) const { return key.hash; }
+};
+
+static void build_poly_dedup_key(const poly& p, poly_dedup_key& key) {
+    struct flat_mono { double q; int begin, end; };
+    std::vector<std::pair<int,int>> raw_terms;
+    std::vector<flat_mono> monos;
+    monos.reserve(p.monoList.size());
+    for (const mono& m : p.monoList) {
+        double c = m.Coef.empty() ? 0.0 : m.Coef[0];
+        double q = std::nearbyint(c * 1e10);
+        if (q == 0.0) q = 0.0; // -0 and 0 print the same
+        int begin = (int)raw_terms.size();
+        for (int kk = 0; kk < (int)m.supIdx.size(); kk++)
+            raw_terms.push_back({m.supIdx[kk], m.supVal[kk]});
+        std::sort(raw_terms.begin() + begin, raw_terms.end());
+        monos.push_back({q, begin, (int)raw_terms.size()});
+    }
+    std::sort(monos.begin(), monos.end(), [&](const flat_mono& a, const flat_mono& b) {
+        if (std::lexicographical_compare(raw_terms.begin() + a.begin, raw_terms.begin() + a.end,
+                                         raw_terms.begin() + b.begin, raw_terms.begin() + b.end)) return true;
+        if (std::lexicographical_compare(raw_terms.begin() + b.begin, raw_terms.begin() + b.end,
+                                         raw_terms.begin() + a.begin, raw_terms.begin() + a.end)) return false;
+        return a.q < b.q;
+    });
+
+    key.words.clear();
+    key.words.reserve(1 + 3 * monos.size() + 2 * raw_terms.size());
+    key.words.push_back(p.typeCone);
+    size_t h = std::hash<int>{}(p.typeCone);
+    int numTerms = 0;
+    for (const flat_mono& fm : monos) {
+        int qbits[2];
+        std::memcpy(qbits, &fm.q, sizeof(qbits));
+        key.words.push_back(qbits[0]);
+        key.words.push_back(qbits[1]);
+        key.words.push_back(fm.end - fm.begin);
+        h = wl_hash_combine(h, wl_hash_double(fm.q));
+        for (int t = fm.begin; t < fm.end; t++) {
+            key.words.push_back(raw_terms[t].first);
+            key.words.push_back(raw_terms[t].second);
+            h = wl_hash_combine(h, std::hash<int>{}(raw_terms[t].first));
+            h = wl_hash_combine(h, std::hash<int>{}(raw_terms[t].second));
+        }
+        numTerms += 2 * (fm.end - fm.begin);
+        h = wl_hash_combine(h, std::hash<int>{}(numTerms));
+    }
+    key.hash = h;
+}
+
+// Collapse symmetric clique blocks
+//   After var_map every clique list is written in orbit representatives, so
+//   cliques from the same orbit become identical lists and only one moment
+//   matrix per orbit is needed. A clique contained in another one is a
+//   principal submatrix of the larger moment matrix and is dropped as well.
+//   Clique lists are bindices[firstClique .. end); returns the orbit size of
+//   every kept clique (in the new order).
+static std::vector<int> reduce_symmetric_cliques(std::vector<std::list<int>>& bindices, int firstClique) {
+    std::vector<std::list<int>> kept;
+    std::vector<int> orbit_size;
+    std::map<std::vector<int>, int> seen; // sorted clique -> position in kept
+
+    for (int i = firstClique; i < (int)bindices.size(); i++) {
+        std::vector<int> key(bindices[i].begin(), bindices[i].end());
+        std::sort(key.begin(), key.end());
+        auto it = seen.find(key);
+        if (it != seen.end()) { orbit_size[it->second]++; continue; }
+        seen.emplace(key, (int)kept.size());
+        kept.push_back(std::list<int>(key.begin(), key.end()));
+        orbit_size.push_back(1);
+    }
+
+    // Drop cliques contained in a larger kept clique (largest first, so the
+    // absorbing clique always survives). A clique can only be contained in a
+    // surviving clique that holds its smallest member, so only those (listed
+    // per variable, in processing order) are tested.
+    std::vector<int> order(kept.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return kept[a].size() > kept[b].size(); });
+    std::vector<char> alive(kept.size(), 1);
+    std::unordered_map<int, std::vector<int>> holders; // variable -> surviving cliques holding it
+    std::vector<int> survivors;                        // every surviving clique, for the empty clique
+    for (int a : order) {
+        const std::vector<int>& cand = kept[a].empty() ? survivors : holders[kept[a].front()];
+        for (int b : cand) {
+            if (kept[b].size() > kept[a].size()
+                    && std::includes(kept[b].begin(), kept[b].end(), kept[a].begin(), kept[a].end())) {
+                alive[a] = 0;
+                orbit_size[b] += orbit_size[a];
+                break;
+            }
+        }
+        if (!alive[a]) continue;
+        survivors.push_back(a);
+        for (int v : kept[a]) holders[v].push_back(a);
+    }
+
+    int numOld = (int)bindices.size() - firstClique;
+    bindices.resize(firstClique);
+    std::vector<int> kept_orbit;
+    for (int a = 0; a < (int)kept.size(); a++) {
+        if (!alive[a]) continue;
+        bindices.push_back(std::move(kept[a]));
+        kept_orbit.push_back(orbit_size[a]);
+    }
+    std::map<int, int> hist; // orbit size -> number of kept cliques
+    for (int s : kept_orbit) hist[s]++;
+    std::cout << "[SYM] Clique blocks: " << numOld << " -> " << kept_orbit.size()
+              << " (one per orbit, " << (int)(kept.size() - kept_orbit.size()) << " contained cliques dropped); orbit sizes:";
+    for (const auto& h : hist) std::cout << " " << h.first << "x" << h.second;
+    std::cout << std::endl;
+    return kept_orbit;
+}
+
+
+// Connected components of the variable-interaction graph
+//   Only the component(s) holding a bounded atom depend on the bound value;
+//   every other component only has to be feasible on its own. Such residual
+//   components are identified by a signature of their constraints and of every
+//   parameter that shapes their SDP (component_config_hash), so a verdict
+//   reached under one relaxation is never reused under another, and looked up
+//   in COMPONENT_CACHE_FILE:
+//     feasible -> the residual constraints are dropped from this probe's SDP
+//     unknown  -> the full system is emitted and the signature is printed as
+//                 "[CC] Pending residual: <sig>"; after a feasible solve the
+//                 solver driver records that signature (and only it) as
+//                 feasible (a feasible full SDP implies a feasible residual).
+//   The residual is never solved on its own: the cache is only filled by
+//   feasible full-system solves, so every probe emits the full SDP until one
+//   of them has been solved feasible under the same configuration.
+//   The driver is the only writer of the cache; it replaces the file under a
+//   lock, so this reader sees either the old or the new contents.
+//   Polys are indexed 0..numPolys-1 in sr.Polysys.polynomial / sr.bindices, with
+//   the clique lists following in sr.bindices. Ids are the var_map representatives.
+static const char* COMPONENT_CACHE_FILE = "../data/sparsepop_components.cache";
+
+// Hash of the parameters that shape the SDP of a residual component
+static size_t component_config_hash(const pop_params& p) {
+    size_t h = std::hash<int>{}(p.relax_Order);
+    const int ints[] = { p.sparseSW, p.scalingSW, p.boundSW, p.reduceMomentMatSW, p.complementaritySW,
+                         p.SquareOneSW, p.binarySW, p.reduceAMatSW, p.aggressiveSW, p.termSparsityIter };
+    for (int v : ints) h = wl_hash_combine(h, std::hash<int>{}(v));
+    const double reals[] = { p.multiCliquesFactor, p.eqTolerance, p.perturbation, p.cliqueMergeThreshold,
+                             p.SDPsolverEpsilon };
+    for (double v : reals) h = wl_hash_combine(h, wl_hash_double(v));
+    h = wl_hash_combine(h, std::hash<std::string>{}(p.termSparsityTS));
+    return h;
+}
+
+static int cc_find(std::vector<int>& parent, int v) {
+    while (parent[v] != v) {
+        parent[v] = parent[parent[v]];
+        v = parent[v];
+    }
+    return v;
+}
+
+static void isolate_query_component(class s3r & sr, const std::vector<int>& var_map, int numVars,
+                                    const std::vector<domain::BoundConstraint>& bounds) {
+    const int numPolys = (int)sr.Polysys.polynomial.size();
+    if (bounds.empty() || numPolys <= 1) return;
+
+    // Union the variables of every constraint (the objective does not take part,
+    // the SDP is solved as a pure feasibility problem)
+    std::vector<int> parent(numVars);
+    std::iota(parent.begin(), parent.end(), 0);
+    for (int i = 1; i < numPolys; i++) {
+        int first = -1;
+        for (const mono& m : sr.Polysys.polynomial[i].monoList) {
+            for (int v : m.supIdx) {
+                if (first < 0) { first = cc_find(parent, v); continue; }
+                int r = cc_find(parent, v);
+                if (r != first) parent[r] = first;
+            }
+        }
+    }
+
+    std::set<int> query_roots;
+    for (const auto& bound : bounds) {
+        if (bound.atomID < 0 || bound.atomID >= numVars) continue;
+        query_roots.insert(cc_find(parent, var_map[bound.atomID]));
+    }
+    if (query_roots.empty()) return;
+
+    auto in_query = [&](int v) { return query_roots.count(cc_find(parent, v)) > 0; };
+    auto poly_in_query = [&](const poly& p) {
+        for (const mono& m : p.monoList)
+            if (!m.supIdx.empty()) return in_query(m.supIdx[0]);
+        return false; // constant constraints do not depend on the bound
+    };
+
+    std::set<int> roots;
+    for (int i = 1; i < numPolys; i++)
+        for (const mono& m : sr.Polysys.polynomial[i].monoList)
+            for (int v : m.supIdx) roots.insert(cc_find(parent, v));
+
+    // Signature of the residual system
+    std::vector<size_t> residual_hashes;
+    poly_dedup_key key;
+    for (int i = 1; i < numPolys; i++) {
+        if (poly_in_query(sr.Polysys.polynomial[i])) continue;
+        build_poly_dedup_key(sr.Polysys.polynomial[i], key);
+        residual_hashes.push_back(key.hash);
+    }
+    std::cout << "[CC] " << roots.size() << " component(s), query atoms in " << query_roots.size()
+              << ", residual constraints: " << residual_hashes.size() << std::endl;
+    if (residual_hashes.empty()) return;
+
+    std::sort(residual_hashes.begin(), residual_hashes.end());
+    size_t sig = wl_hash_combine(component_config_hash(sr.param), std::hash<size_t>{}(residual_hashes.size()));
+    for (size_t h : residual_hashes) sig = wl_hash_combine(sig, h);
+    char sig_buf[32];
+    snprintf(sig_buf, sizeof(sig_buf), "%016llx", (unsigned long long)sig);
+    std::string signature(sig_buf);
+
+    std::string status;
+    {
+        ifstream cf(COMPONENT_CACHE_FILE);
+        string cs, cstat;
+        while (cf >> cs >> cstat) {
+            if (cs == signature) status = cstat;
+        }
+    }
+
+    if (status != "feasible") {
+        std::cout << "[CC] Pending residual: " << signature << std::endl;
+        std::cout << "[CC] Residual " << signature << " not known feasible, emitting the full system" << std::endl;
+        return;
+    }
+
+    // Residual components are cached as feasible: keep the query component only
+    std::vector<poly> kept_polys;
+    std::vector<std::list<int>> kept_bindices;
+    for (int i = 0; i < numPolys; i++) {
+        if (i > 0 && !poly_in_query(sr.Polysys.polynomial[i])) continue;
+        kept_polys.push_back(std::move(sr.Polysys.polynomial[i]));
+        kept_bindices.push_back(std::move(sr.bindices[i]));
+    }
+    // objective: keep monomials of the query component and the constant
+    poly& obj = kept_polys[0];
+    for (auto it = obj.monoList.begin(); it != obj.monoList.end(); ) {
+        if (!std::all_of(it->supIdx.begin(), it->supIdx.end(), in_query)) {
+            it = obj.monoList.erase(it);
+            obj.noTerms--;
+        } else {
+            ++it;
+        }
+    }
+    for (int i = numPolys; i < (int)sr.bindices.size(); i++)
+        kept_bindices.push_back(std::move(sr.bindices[i]));
+
+    // Restrict basis indices and cliques to the query component
+    for (int i = 0; i < (int)kept_bindices.size(); i++) {
+        auto& bl = kept_bindices[i];
+        for (auto it = bl.begin(); it != bl.end(); ) {
+            int rep = (*it < (int)var_map.size()) ? var_map[*it] : *it;
+            if (rep < numVars && in_query(rep)) ++it;
+            else it = bl.erase(it);
+        }
+    }
+    int firstClique = (int)kept_polys.size();
+    kept_bindices.erase(std::remove_if(kept_bindices.begin() + firstClique, kept_bindices.end(),
+                                       [](const std::list<int>& l) { return l.empty(); }),
+                        kept_bindices.end());
+
+    std::cout << "[CC] Residual " << signature << " cached feasible: dropped "
+              << (numPolys - (int)kept_polys.size()) << " constraints, " << kept_polys.size() << " remain" << std::endl;
+    sr.Polysys.polynomial = std::move(kept_polys);
+    sr.bindices           = std::move(kept_bindices);
+    sr.Polysys.numSys     = (int)sr.Polysys.polynomial.size();
+}
+
+// Term sparsity (TSSOS-style block reduction)
+//   Every PSD block with basis B and polynomial multiplier g (g = 1 for a moment
+//   matrix) gets a term-sparsity graph: b_i ~ b_j when b_i + b_j + a lies in the
+//   support set S for some a in supp(g). S starts from the supports of the
+//   objective and all constraints plus the diagonal 2b of every basis monomial.
+//   The block closure (connected components) or a chordal extension (maximal
+//   cliques) of each graph splits the block, and S is refreshed from the
+//   products inside the new blocks for the next iteration.
+//   Exponents are reduced by x^2 = x and x^2 = 1 (VarFlags::reduce) first, exactly
+//   as the SDP writer reduces them, so the supports are compared as emitted.
+struct ts_sup_hash {
+    size_t operator()(const sup& s) const {
+        size_t h = s.idx.size();
+        for (int k = 0; k < (int)s.idx.size(); k++) {
+            h ^= (size_t)s.idx[k] * 0x9e3779b97f4a7c15ULL + (size_t)s.val[k] + (h << 6) + (h >> 2);
+        }
+        return h;
+    }
+};
+typedef std::unordered_set<sup, ts_sup_hash> ts_sup_set;
+
+// out = reduce(a + b + c)
+static void ts_sum(const sup& a, const sup& b, const sup& c, const VarFlags& flags, sup& out) {
+    out.idx.clear();
+    out.val.clear();
+    const sup* terms[3] = {&a, &b, &c};
+    for (int t = 0; t < 3; t++) {
+        for (int k = 0; k < (int)terms[t]->idx.size(); k++) {
+            out.idx.push_back(terms[t]->idx[k]);
+            out.val.push_back(terms[t]->val[k]);
+        }
+    }
+    // few nonzeros: insertion sort by index, then merge equal indices
+    for (int i = 1; i < (int)out.idx.size(); i++) {
+        for (int j = i; j > 0 && out.idx[j - 1] > out.idx[j]; j--) {
+            std::swap(out.idx[j - 1], out.idx[j]);
+            std::swap(out.val[j - 1], out.val[j]);
+        }
+    }
+    int n = 0;
+    for (int i = 0; i < (int)out.idx.size(); i++) {
+        if (n > 0 && out.idx[n - 1] == out.idx[i]) out.val[n - 1] += out.val[i];
+        else { out.idx[n] = out.idx[i]; out.val[n] = out.val[i]; n++; }
+    }
+    int m = 0;
+    for (int i = 0; i < n; i++) {
+        int v = out.val[i];
+        v = flags.reduce(out.idx[i], v);
+        if (v == 0) continue;
+        out.idx[m] = out.idx[i];
+        out.val[m] = v;
+        m++;
+    }
+    out.idx.resize(m);
+    out.val.resize(m);
+}
+
+static int ts_find(std::vector<int>& parent, int x) {
+    while (parent[x] != x) {
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+    }
+    return x;
+}
+
+struct ts_block {
+    std::vector<sup> basis;
+    std::vector<sup> shift;                // supp(g); the constant monomial for a moment matrix
+    std::vector<std::vector<int> > parts;  // basis positions of each sub-block
+};
+
+// Sub-blocks of one PSD block: the connected components of its term-sparsity
+// graph (block closure), or the maximal cliques of an approximate minimum
+// degree chordal extension of it (chordal).
+static void ts_split(ts_block& blk, const ts_sup_set& S, const VarFlags& flags, bool chordal) {
+    int k = blk.basis.size();
+    std::vector<int> comp(k);
+    for (int i = 0; i < k; i++) comp[i] = i;
+    std::vector<std::pair<int,int> > edges;
+    sup prod;
+    for (int i = 0; i < k; i++) {
+        for (int j = i + 1; j < k; j++) {
+            if (!chordal && ts_find(comp, i) == ts_find(comp, j)) continue;
+            for (const sup& a : blk.shift) {
+                ts_sum(blk.basis[i], blk.basis[j], a, flags, prod);
+                if (S.count(prod)) {
+                    if (chordal) edges.push_back(std::make_pair(i, j));
+                    else comp[ts_find(comp, j)] = ts_find(comp, i);
+                    break;
+                }
+            }
+        }
+    }
+    blk.parts.clear();
+    if (chordal) {
+        class CspGraph graph;
+        graph.build(k, edges);
+        std::vector<int> perm;
+        amdOrder(graph, perm);
+        class cliques cl;
+        genMaxCliquesEtree(graph, perm, cl, false);
+        for (int c = 0; c < cl.numcliques; c++)
+            blk.parts.push_back(std::vector<int>(cl.clique[c].begin(), cl.clique[c].end()));
+        return;
+    }
+    std::vector<int> partOf(k, -1);
+    for (int i = 0; i < k; i++) {
+        int r = ts_find(comp, i);
+        if (partOf[r] < 0) {
+            partOf[r] = blk.parts.size();
+            blk.parts.push_back(std::vector<int>());
+        }
+        blk.parts[partOf[r]].push_back(i);
+    }
+}
+
+static void ts_poly_supports(const poly& p, std::vector<sup>& sups) {
+    sups.clear();
+    for (const mono& m : p.monoList) {
+        sup s;
+        s.idx = m.supIdx;
+        s.val = m.supVal;
+        sups.push_back(s);
+    }
+}
+
+void term_sparsity_blocks(int numIter, bool chordal, const VarFlags& flags,
+                          class polysystem& polysys, std::vector<class supSet>& BaSupVect,
+                          std::vector<class supSet>& mmBaSupVect) {
+    int dim = polysys.dimvar();
+    sup zero;
+
+    // collect the PSD blocks: localizing matrices of inequalities, then moment matrices
+    std::vector<ts_block> blocks;
+    std::vector<int> owner;   // constraint index of a localizing block, -1 for a moment matrix
+    for (int i = 1; i < polysys.numsys(); i++) {
+        if (polysys.polyTypeCone(i) != INE || BaSupVect[i].size() <= 1) continue;
+        ts_block blk;
+        blk.basis.assign(BaSupVect[i].begin(), BaSupVect[i].end());
+        ts_poly_supports(polysys.polynomial[i], blk.shift);
+        blocks.push_back(std::move(blk));
+        owner.push_back(i);
+    }
+    for (int i = 0; i < (int)mmBaSupVect.size(); i++) {
+        if (mmBaSupVect[i].size() <= 1) continue;
+        ts_block blk;
+        blk.basis.assign(mmBaSupVect[i].begin(), mmBaSupVect[i].end());
+        blk.shift.push_back(zero);
+        blocks.push_back(std::move(blk));
+        owner.push_back(-1 - i);
+    }
+    if (blocks.empty()) return;
+
+    ts_sup_set S0;
+    std::vector<sup> psups;
+    sup s;
+    for (int i = 0; i < polysys.numsys(); i++) {
+        ts_poly_supports(polysys.polynomial[i], psups);
+        for (const sup& a : psups) {
+            ts_sum(a, zero, zero, flags, s);
+            S0.insert(s);
+        }
+    }
+    for (const ts_block& blk : blocks) {
+        for (const sup& b : blk.basis) {
+            ts_sum(b, b, zero, flags, s);
+            S0.insert(s);
+        }
+    }
+
+    ts_sup_set S = S0;
+    long long sqPrev = -1;
+    for (int it = 1; it <= numIter; it++) {
+        #pragma omp parallel for schedule(dynamic)
+        for (int b = 0; b < (int)blocks.size(); b++) {
+            ts_split(blocks[b], S, flags, chordal);
+        }
+        long long sq = 0;
+        for (const ts_block& blk : blocks) {
+            for (const std::vector<int>& part : blk.parts) sq += (long long)part.size() * part.size();
+        }
+        if (sq == sqPrev || it == numIter) break;
+        sqPrev = sq;
+        S = S0;
+        for (const ts_block& blk : blocks) {
+            for (const std::vector<int>& part : blk.parts) {
+                for (int x = 0; x < (int)part.size(); x++) {
+                    for (int y = x + 1; y < (int)part.size(); y++) {
+                        for (const sup& a : blk.shift) {
+                            ts_sum(blk.basis[part[x]], blk.basis[part[y]], a, flags, s);
+                            S.insert(s);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // replace each block by its sub-blocks; extra localizing blocks repeat the constraint
+    long long sqBefore = 0, sqAfter = 0;
+    int maxBefore = 0, maxAfter = 0, numAfter = 0;
+    std::vector<class supSet> mmNew;
+    std::vector<char> mmSplit(mmBaSupVect.size(), 0);
+    for (int b = 0; b < (int)blocks.size(); b++) {
+        ts_block& blk = blocks[b];
+        int k = blk.basis.size();
+        sqBefore += (long long)k * k;
+        maxBefore = std::max(maxBefore, k);
+        std::vector<class supSet> parts(blk.parts.size());
+        for (int p = 0; p < (int)blk.parts.size(); p++) {
+            parts[p].setDimVar(dim);
+            for (int i : blk.parts[p]) parts[p].pushSup(blk.basis[i]);
+            sqAfter += (long long)parts[p].size() * parts[p].size();
+            maxAfter = std::max(maxAfter, parts[p].size());
+        }
+        numAfter += parts.size();
+        if (owner[b] >= 0) {
+            int i = owner[b];
+            BaSupVect[i] = parts[0];
+            for (int p = 1; p < (int)parts.size(); p++) {
+                class poly copy = polysys.polynomial[i];
+                copy.setNoSys(polysys.numsys() + 1);
+                polysys.addPoly(copy);
+                BaSupVect.push_back(parts[p]);
+            }
+        } else {
+            int i = -1 - owner[b];
+            mmSplit[i] = 1;
+            for (class supSet& part : parts) mmNew.push_back(part);
+        }
+    }
+    for (int i = 0; i < (int)mmBaSupVect.size(); i++) {
+        if (!mmSplit[i]) mmNew.push_back(mmBaSupVect[i]);
+    }
+    mmBaSupVect.swap(mmNew);
+
+    std::cout << "[TS] Term sparsity: " << blocks.size() << " PSD blocks -> " << numAfter
+              << ", max size " << maxBefore << " -> " << maxAfter
+              << ", sum of squared sizes " << sqBefore << " -> " << sqAfter << std::endl;
+}
+
+// stamp the boundary k of the conversion_part2 stages: wall clock and memory
+static void stamp_stage(class s3r & sr, int k){
+    sr.timedata[k] = metrics::wall_seconds();
+    sr.rssdata[k] = metrics::current_rss_bytes();
+    sr.peakdata[k] = metrics::peak_rss_bytes();
+}
+
 void conversion_part2(
         /*IN*/  class s3r & sr,
         vector<vector<double>>& fixedVar,
@@ -3540,12 +4397,13 @@ void conversion_part2(
     class spvec_array allsups_st;
     class spvec_array removesups;
 	vector<int> binvec, Sqvec;
+	class VarFlags varFlags;
     class supSet czSups, binSups, SqSups;
     class spvec_array mmsups;
     class spvec_array allsups;
     
 	int val = 0;
-    sr.timedata[0] = (double)clock();
+    stamp_stage(sr, 0);
 	val = getmem();
     
     // Generate max cliques
@@ -3556,14 +4414,20 @@ void conversion_part2(
             sr.maxcliques.clique[0].push_back(i);
         }
     }else if(sr.param.sparseSW == 1){
-        gen_maxcliques3(sr.Polysys.dimVar, oriidx, extofcsp, sr.maxcliques);
+        // makeSDPr already extracted the cliques from the elimination tree;
+        // fall back to the dense path only when a caller supplied a chordal extension.
+        if(sr.maxcliques.numcliques == 0){
+            gen_maxcliques3(sr.Polysys.dimVar, oriidx, extofcsp, sr.maxcliques);
+        }
+        // merge small overlapping cliques along the clique tree when the cost model favours it
+        merge_cliques(sr.param.relax_Order, sr.param.cliqueMergeThreshold, sr.param.detailedInfFile, sr.maxcliques);
     }else{
         printf("sparseSW should be 0 or 1.\n");
     }
     if(sr.param.detailedInfFile.empty() == false){
         sr.maxcliques.write_maxCliques(sr.param.detailedInfFile);
     }
-    sr.timedata[1] = (double)clock();
+    stamp_stage(sr, 1);
 	val = getmem();
     
     // Generate basis indices to be stored in sr.bindices
@@ -3579,7 +4443,7 @@ void conversion_part2(
     if(sr.param.detailedInfFile.empty() == false){
         sr.write_BasisIndices(sr.param.detailedInfFile);
     }
-    sr.timedata[2] = (double)clock();
+    stamp_stage(sr, 2);
 	val = getmem();
 
     //////////////////////////////////
@@ -3743,8 +4607,15 @@ void conversion_part2(
     // cout << "------Done Printing NEW Polynomials-------" << endl;
     // printBindices(sr.bindices, newNumConst, sr.maxcliques.numcliques, "New Bindices");
 
+    // Presolve: tighten bounds, substitute fixed atoms, drop redundant constraints
+    if (!presolve_grounded_system(sr, newLo, newUp, observedValueById, newNumVars)) {
+        cout << "## Presolve proved the grounded system infeasible; no SDP is written." << endl;
+        exit(PRESOLVE_INFEASIBLE);
+    }
+    newNumConst = sr.Polysys.numSys;
+
     // Run WL fingerprinting
-    std::vector<size_t> wl_labels = compute_wl_fingerprints(sr.Polysys.polynomial, newNumVars, observedValueById);
+    std::vector<int> wl_labels = compute_wl_fingerprints(sr.Polysys.polynomial, newNumVars, observedValueById);
 
     // Build the symmetry map and print which variables are merged
     std::vector<int> var_map = build_symmetry_map(wl_labels, newNumVars, observedValueById);
@@ -3820,6 +4691,9 @@ void conversion_part2(
     }
     std::cout << "[WL] Step 1 complete: monoLists rebuilt with var_map applied" << std::endl;
 
+    // Emit only the component(s) holding the bounded atom when the rest is known feasible
+    isolate_query_component(sr, var_map, newNumVars, bounds);
+
     // // For testing our mapping
     // cout << '\n' << "------Printing NEW Polynomials (after var_map) -------" << endl;
     // for (auto& poly : sr.Polysys.polynomial) {
@@ -3908,42 +4782,34 @@ void conversion_part2(
 
     // Deduplication: Remove polynomials that are identical after equivalence variable mapping // 
 
-    // Build a canonical fingerprint string for one polynomial
-    auto poly_fingerprint = [](const poly& p) -> std::string {
-        std::vector<std::string> mono_strs;
-        for (const auto& m : p.monoList) {
-            // Use high-precision coefficient to avoid false equality
-            char coef_buf[64];
-            snprintf(coef_buf, sizeof(coef_buf), "%.10f", m.Coef.empty() ? 0.0 : m.Coef[0]);
-            std::string ms = std::string(coef_buf) + ":";
-            for (int kk = 0; kk < (int)m.supIdx.size(); kk++) {
-                ms += std::to_string(m.supIdx[kk]) + "^" + std::to_string(m.supVal[kk]) + ",";
-            }
-            mono_strs.push_back(ms);
-        }
-        // Sort so monoList insertion order doesn't affect the fingerprint
-        std::sort(mono_strs.begin(), mono_strs.end());
-        std::string fp = std::to_string(p.typeCone) + "|";
-        for (const auto& s : mono_strs) fp += s + ";";
-        return fp;
-    };
-    std::set<std::string> seen_fps;
+    // Build the canonical flat key of every polynomial (in parallel), then keep
+    // the first polynomial of each key. Keys hash into a flat set; equal
+    // hashes are confirmed by a full compare of the canonical monomials.
+    const int numPolys = (int)sr.Polysys.polynomial.size();
+    std::vector<poly_dedup_key> poly_keys(numPolys);
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (int i = 0; i < numPolys; i++) {
+        build_poly_dedup_key(sr.Polysys.polynomial[i], poly_keys[i]);
+    }
+
+    FlatMonomialMap<poly_dedup_key, poly_dedup_key_hash> seen_keys;
     std::vector<poly> dedup_polys;
     std::vector<std::list<int>> dedup_bindices;
 
-    for (int i = 0; i < (int)sr.Polysys.polynomial.size(); i++) {
-        std::string fp = poly_fingerprint(sr.Polysys.polynomial[i]);
-        if (seen_fps.insert(fp).second) {
-            dedup_polys.push_back(sr.Polysys.polynomial[i]);
-            dedup_bindices.push_back(sr.bindices[i]);
+    for (int i = 0; i < numPolys; i++) {
+        if (seen_keys.find_or_insert(poly_keys[i], i) == i) {
+            dedup_polys.push_back(std::move(sr.Polysys.polynomial[i]));
+            dedup_bindices.push_back(std::move(sr.bindices[i]));
         }
     }
+    poly_keys.clear();
+    seen_keys.clear();
 
-    for (int i = (int)sr.Polysys.polynomial.size(); i < (int)sr.bindices.size(); i++) {
-        dedup_bindices.push_back(sr.bindices[i]);
+    for (int i = numPolys; i < (int)sr.bindices.size(); i++) {
+        dedup_bindices.push_back(std::move(sr.bindices[i]));
     }
 
-    int removed = (int)sr.Polysys.polynomial.size() - (int)dedup_polys.size();
+    int removed = numPolys - (int)dedup_polys.size();
     sr.Polysys.polynomial = std::move(dedup_polys);
     sr.bindices           = std::move(dedup_bindices);
     sr.Polysys.numSys     = (int)sr.Polysys.polynomial.size();
@@ -3951,6 +4817,14 @@ void conversion_part2(
 
     std::cout << "[WL] Dedup complete: removed " << removed << " duplicate polynomials, " << sr.Polysys.polynomial.size() << " remain" << std::endl;
 
+    // One moment matrix per orbit of identical cliques. The symmetry group acts
+    // trivially on the representatives left in each clique basis, so the
+    // symmetry-adapted blocks of a moment matrix are exactly these reduced cliques.
+    std::vector<int> clique_orbits = reduce_symmetric_cliques(sr.bindices, sr.Polysys.numSys);
+    sr.maxcliques.initialize(newNumVars, (int)clique_orbits.size());
+    for (int i = 0; i < (int)clique_orbits.size(); i++)
+        sr.maxcliques.clique[i] = sr.bindices[sr.Polysys.numSys + i];
+
     cout << '\n' << "------Printing NEW Polynomials(" << sr.Polysys.polynomial.size() << ") (after all changes) -------" << endl;
     for (auto& poly : sr.Polysys.polynomial) {
         printPolynomial(poly, "resulting poly");
@@ -3976,12 +4850,12 @@ void conversion_part2(
         sr.write_BasisSupports(0, sr.param.detailedInfFile, BasisSupports);
     }
     
-    sr.timedata[3] = (double)clock();
+    stamp_stage(sr, 3);
 	val = getmem();
     
     //get polyinfo_obj( array data-type to have polynomial form data )
     initialize_polyinfo(sr.Polysys, 0, polyinfo_obj);
-    sr.timedata[4] = (double)clock();
+    stamp_stage(sr, 4);
 	val = getmem();
 
     // Prepare for constraint processing
@@ -3994,13 +4868,13 @@ void conversion_part2(
         bassinfo_st.resize(stsize);
         get_subjectto_polys_and_basups(sr.Polysys, sr.bindices, BasisSupports.supsetArray, stsize, polyinfo_st, bassinfo_st);
     }
-    sr.timedata[5] = (double)clock();
+    stamp_stage(sr, 5);
 	val = getmem();
     // Create global set of supports, i.e. exhaustive set of monomials that can be referenced anywhere
     // built by taking union of all monomials from the objective, constraints, and all basis supports
     // these are stored in allsups_st
     get_allsups(sr.Polysys.dimvar(), polyinfo_obj, stsize, polyinfo_st, bassinfo_st, allsups_st);
-    sr.timedata[6] = (double)clock();
+    stamp_stage(sr, 6);
 	val = getmem();
 
     // The monomials gathered by get_allsups are stored in a spvec_array, however we desire them to be sup objects
@@ -4008,7 +4882,7 @@ void conversion_part2(
     // allSups is now a supSet: a set of all monomials, each as a sup object.
     class supSet allSups;
     initialize_supset(allsups_st, allSups);
-    sr.timedata[7] = (double)clock();
+    stamp_stage(sr, 7);
 	val = getmem();
 
 
@@ -4019,13 +4893,28 @@ void conversion_part2(
     if(sr.param.detailedInfFile.empty() == false){
         sr.write_BasisSupports(1, sr.param.detailedInfFile, BasisSupports);
     }
-	sr.timedata[8] = (double)clock();
+	stamp_stage(sr, 8);
 	val = getmem();
 
     // Filter Basis Supports for Redundancy // 
+	// per-variable flags, built once and used by every reduction below and by the writer
+	varFlags.init(sr.Polysys.dimvar());
+	for(int ci = 0; ci < k && ci < varFlags.size(); ci++){
+		int v = inv_compact[ci];
+		if(v < (int)observedValueById.size() && !std::isnan(observedValueById[v])){
+			varFlags.flag[ci] |= VarFlags::OBSERVED;
+		}
+	}
 	//eliminate supports of each basis supports, using special complementarity x*y=0
 	if(sr.param.complementaritySW==YES){
 		get_removesups(sr.Polysys, removesups);
+		for(int i=0; i<removesups.pnz_size; i++){
+			for(int j=0; j<removesups.pnz[1][i]; j++){
+				if(removesups.pnz[0][i] >= 0 && removesups.vap[0][removesups.pnz[0][i]+j] < varFlags.size()){
+					varFlags.flag[removesups.vap[0][removesups.pnz[0][i]+j]] |= VarFlags::COMPLEMENT;
+				}
+			}
+		}
 		initialize_supset(removesups, czSups);
 		if(czSups.size()>0){
 			sr.eraseCompZeroSups(czSups, BasisSupports.supsetArray);
@@ -4048,19 +4937,22 @@ void conversion_part2(
         for (int i = 0; i < sr.Polysys.dimvar(); i++) {
             binvec.push_back(i);
         }
+        varFlags.set(binvec, VarFlags::BINARY);
         if(binvec.empty() == false){
-            sr.eraseBinarySups(binvec, BasisSupports.supsetArray);
-            sr.eraseBinaryInObj(binvec);
+            sr.eraseBinarySups(varFlags, BasisSupports.supsetArray);
+            sr.eraseBinaryInObj(varFlags);
         }
     }
 	//eliminate supports of each basis supports, using xi^2 -1=0
 	if(sr.param.SquareOneSW==YES){
 		get_SquareOneSup(sr.Polysys, Sqvec);
+		varFlags.set(Sqvec, VarFlags::SQUAREONE);
 		if(Sqvec.empty() == false){
-			sr.eraseSquareOneSups(Sqvec, BasisSupports.supsetArray);
-			sr.eraseSquareOneInObj(Sqvec);
+			sr.eraseSquareOneSups(varFlags, BasisSupports.supsetArray);
+			sr.eraseSquareOneInObj(varFlags);
 		}
 	}
+	varFlags.disp();
 	vector<int> remainIdx;
     // Remove redundant constraints
 	sr.Polysys.removeEQU(remainIdx);
@@ -4069,7 +4961,7 @@ void conversion_part2(
 	int num = sr.Polysys.removeIdx.size(); // Analyze system of polynomials and determine which constraints can be eliminated
 	BasisSupports.removeEQU(num, remainIdx); // Remove basis supports of removed constraints
 
-	sr.timedata[9] = (double)clock();
+	stamp_stage(sr, 9);
 	val = getmem();
 
     // Prepare for moment matrix creation
@@ -4079,7 +4971,7 @@ void conversion_part2(
 	// Fills bassinfo_mm with the variable sets and supports for each moment matrix, using the basis indices and supports from earlier steps.
 	get_momentmatrix_basups(sr.Polysys, sr.bindices, BasisSupports.supsetArray, bassinfo_mm);
 
-    sr.timedata[10] = (double)clock();
+    stamp_stage(sr, 10);
 	val = getmem();
 
     // Generate all the monomials (supports) that will appear as entries in the moment matrices for the SDP relaxation.
@@ -4091,7 +4983,7 @@ void conversion_part2(
 	
     // Memory-efficient change: skip mmsups computation
     // get_allsups_in_momentmatrix(sr.Polysys.dimvar(), mmsize, bassinfo_mm, mmsups);
-	sr.timedata[11] = (double)clock();
+	stamp_stage(sr, 11);
 	val = getmem();
     
 
@@ -4120,7 +5012,7 @@ void conversion_part2(
 
     // Simplifies the array (removes duplicates, sorts, etc) //
 	simplification(allsups);
-	sr.timedata[12] = (double)clock();
+	stamp_stage(sr, 12);
 	val = getmem();
 	//eliminate vain supports of allsupports, using special complementary supports x(a) = 0
 	//binary constraints xi^2 -xi = 0 and SquareOne constraints xi^2 - 1 = 0 
@@ -4128,17 +5020,17 @@ void conversion_part2(
 		remove_sups(removesups, allsups);
 	}
 	if(sr.param.binarySW == YES  && binvec.empty() == false){
-		remove_Binarysups(binvec, allsups);
+		remove_Binarysups(varFlags, allsups);
 	}
 	if(sr.param.SquareOneSW == YES  && Sqvec.empty() == false){
-		remove_SquareOnesups(Sqvec, allsups);
+		remove_SquareOnesups(varFlags, allsups);
 	}
-	sr.timedata[13] = (double)clock();
+	stamp_stage(sr, 13);
 	val = getmem();
     
     // convert global supports(allsups) to supset format(allSups)
 	initialize_supset(allsups, allSups);
-	sr.timedata[14] = (double)clock();
+	stamp_stage(sr, 14);
 	val = getmem();
     
 	bool flag = true;
@@ -4170,7 +5062,7 @@ void conversion_part2(
 		allSups.sort();
 		sr.Polysys.addBoundToPOP_simple(allSups, numofbds);
 	}
-	sr.timedata[15] = (double)clock();
+	stamp_stage(sr, 15);
 	val = getmem();
 	//cout << "15 " << sr.timedata[15] << endl;
     
@@ -4189,7 +5081,11 @@ void conversion_part2(
 			BasisSupports.push(SE1Set);
 		}
 	}
-	sr.timedata[16] = (double)clock();
+	// split moment and localizing matrices into term-sparsity blocks
+	if(sr.param.termSparsityIter > 0){
+		term_sparsity_blocks(sr.param.termSparsityIter, sr.param.termSparsityTS == "chordal", varFlags, sr.Polysys, BasisSupports.supsetArray, mmBaSupVect);
+	}
+	stamp_stage(sr, 16);
 	val = getmem();
     
 	//polyinfo,bassinfo
@@ -4197,7 +5093,7 @@ void conversion_part2(
 	vector<class poly_info> polyinfo(msize);
 	vector<class spvec_array> bassinfo(msize);
 	get_poly_a_bass_info(sr.Polysys, BasisSupports.supsetArray, mmBaSupVect, msize, polyinfo, bassinfo);
-	sr.timedata[17] = (double)clock();
+	stamp_stage(sr, 17);
 	val = getmem();
 
 
@@ -4220,20 +5116,29 @@ void conversion_part2(
     // Done freeing structures
 
     // Streaming Approach
-    sr.timedata[18] = (double)clock();
+    stamp_stage(sr, 18);
     val = getmem();
     
     // Streaming writes SDP directly to file with simplifications applied
+    SdpFormat sdpFormat = SDP_TEXT;
     std::string outputFile = "../data/sparsepop_output_test.dat-s";
+    if (sr.param.sdpFormat == "binary") {
+        sdpFormat = SDP_BINARY;
+        outputFile = "../data/sparsepop_output_test.sdpb";
+    } else if (sr.param.sdpFormat == "cbf") {
+        sdpFormat = SDP_CBF;
+        outputFile = "../data/sparsepop_output_test.cbf";
+    }
     std::cout << "\nWriting SDP to: " << outputFile << std::endl;
-    stream_psdp_to_file(sr.Polysys.dimvar(), msize, polyinfo, bassinfo, outputFile, binvec, Sqvec);
+    stream_psdp_to_file(sr.Polysys.dimvar(), msize, polyinfo, bassinfo, outputFile, &varFlags, true, sdpFormat,
+                        (size_t)sr.param.monomialMemoryMB << 20);
     std::cout << "SDP file written successfully!" << std::endl;
     
-    sr.timedata[19] = (double)clock();
+    stamp_stage(sr, 19);
     val = getmem();
     // End streaming
     
-    sr.timedata[20] = (double)clock();
+    stamp_stage(sr, 20);
     val = getmem();
 
     // // === STREAMING TEST: Generate parallel output for comparison ===
@@ -4296,16 +5201,27 @@ void conversion_part2(
     // sr.timedata[20] = (double)clock();
 	// val = getmem();
     // //cout << "20 " << sr.timedata[20] << endl;
+	// timedata[] holds wall-clock stamps; stage i runs from timedata[i] to timedata[i+1]
+	static const char* stageNames[20] = {
+		"cliques", "basis indices", "grounding/presolve/bases", "objective info",
+		"constraint info", "allsups (constraints)", "allsups set", "reduceSupSets",
+		"binary/square-one reduction", "moment matrix info", "moment supports",
+		"collect supports", "remove supports", "support set", "bounds",
+		"moment split/term sparsity", "poly/bass info", "release", "stream SDPA", "memory check"};
+	for(int i=0; i<20; i++){
+		metrics::record_stage(stageNames[i], sr.timedata[i+1] - sr.timedata[i],
+				sr.rssdata[i], sr.rssdata[i+1], sr.peakdata[i+1]);
+	}
 #ifdef DEBUG
 	double t;
 	for(int i=0; i<20; i++){
-		t = (sr.timedata[i+1] - sr.timedata[i])/(double)CLOCKS_PER_SEC;
+		t = sr.timedata[i+1] - sr.timedata[i];
 		if(t > 1){
 			printf("[%2d] %4.2f sec\n", i,t);
 		}
 	}
 
-	double total = (double)(sr.timedata[20]-sr.timedata[0])/(double)CLOCKS_PER_SEC;
+	double total = sr.timedata[20]-sr.timedata[0];
 	printf("total = %5.2f sec\n", total);
 #endif
 }
@@ -31,6 +31,7 @@
 #include "Parameters.h"
 
 #include "../include/domain.h"
+#include "../include/metrics.h"
 
 /*** conversion ****************************************/
 void conversion_part1(
@@ -40,6 +41,9 @@ void conversion_part1(
         int & blen, vector<double> & bvect,
         int & mlen, vector<double> & permmatrix);
 
+/* exit status of the program when presolve proves the grounded system infeasible */
+#define PRESOLVE_INFEASIBLE 3
+
 void conversion_part2(
         /*IN*/  class s3r & sr,
         vector<vector<double>>& fixedVar,
@@ -78,11 +82,11 @@ void get_lsdp(class spvec_array & allsupset, class mysdp & psdp, vector<int> & d
 void pushsups(/*IN*/ class spvec_array & insups, /*OUT*/ class spvec_array & outsups);
 void simplification(/*IN*/ class spvec_array & vecs);
 
-void remove_Binarysups(class mysdp & psdp, vector<int> binvec);
-void remove_SquareOnesups(class mysdp & psdp, vector<int> Sqvec);
+void remove_Binarysups(class mysdp & psdp, const class VarFlags & flags);
+void remove_SquareOnesups(class mysdp & psdp, const class VarFlags & flags);
 void remove_sups(class mysdp & psdp, class spvec_array & removesups);
-void remove_Binarysups(vector<int> binvec, class spvec_array & allsups);
-void remove_SquareOnesups(vector<int> Sqvec, class spvec_array & allsups);
+void remove_Binarysups(const class VarFlags & flags, class spvec_array & allsups);
+void remove_SquareOnesups(const class VarFlags & flags, class spvec_array & allsups);
 void remove_sups(class spvec_array & removesups, class spvec_array & sups);
 
 //function that write the sparse format of the SDP into the file
@@ -99,6 +103,9 @@ void get_subjectto_polys_and_basups(
         /* IN */  class polysystem & polysys, vector<list<int> > BaIndices, vector<class supSet> & basups,
         /* OUT */ int stsize, vector<class poly_info> & polyinfo_st, vector<class bass_info> & bassinfo_st);
 void get_momentmatrix_basups(class polysystem & polysys, vector<list<int> > BaIndices, vector<class supSet> & basups, vector<class bass_info> & bassinfo_st);
+//split PSD blocks by term sparsity; extra localizing blocks are appended to polysys and BaSupVect
+void term_sparsity_blocks(int numIter, bool chordal, const class VarFlags & flags,
+        class polysystem & polysys, vector<class supSet> & BaSupVect, vector<class supSet> & mmBaSupVect);
 
 void get_allsups(int dim, class poly_info & polyinfo_obj, int stsize, vector<class poly_info> & polyinfo_st, vector<class bass_info> & bassinfo_st, class spvec_array & allsups);
 void get_allsups_in_momentmatrix(int dimvar, int mmsize, vector<class bass_info> & bassinfo_mm, class spvec_array & mmsups);
@@ -141,7 +148,6 @@ public:
     int itemp;
     string problemName;
     class polysystem Polysys;
-    class polysystem OriPolysys;
     
     s3r();//constructor
     ~s3r(){
@@ -162,9 +168,13 @@ public:
     
     vector<double> timedata1;
     vector<double> timedata;
+    // resident / peak memory (bytes) at the same stamps as timedata
+    vector<size_t> rssdata;
+    vector<size_t> peakdata;
     
     vector<double> scalevalue;
     vector<double> bvect;
+    // diagonal of the scaling matrix: x[i] = permmatrix[i]*y[i] + bvect[i]
     vector<double> permmatrix;
     vector<list<int> > bindices;
     
@@ -182,18 +192,15 @@ public:
     string detailedInfFile;
     string sdpaDataFile;
     
-    //objective function
-    class poly objPoly;
-    
     void set_relaxOrder(int Order=2);
     
     void genBasisSupports(class supsetSet & BasisSupports);
     void reduceSupSets(class supsetSet & BasisSupports, class supSet & allNzSups);
-    void eraseBinaryInObj(vector<int> binvec); //delete the supports from objective function via binary constraints (xi^2 - xi = 0)
-    void eraseSquareOneInObj(vector<int> Sqvec); //delete the supports from objective function via Square-One constraints (xi^2 -1 = 0)
+    void eraseBinaryInObj(const class VarFlags & flags); //delete the supports from objective function via binary constraints (xi^2 - xi = 0)
+    void eraseSquareOneInObj(const class VarFlags & flags); //delete the supports from objective function via Square-One constraints (xi^2 -1 = 0)
     void eraseCompZeroSups(class supSet & czSups); //delete the supports from objective function via complementarity constraints
-    void eraseBinarySups(vector<int> binvec, vector<class supSet> & BaSups); //delete the supports from Polynomial SDPs via binary constraints (xi^2 - xi = 0)
-    void eraseSquareOneSups(vector<int> Sqvec, vector<class supSet> & BaSups); //delete the supports from Polynomial SDPs via Square-One constraints (xi^2 -1 = 0)
+    void eraseBinarySups(const class VarFlags & flags, vector<class supSet> & BaSups); //delete the supports from Polynomial SDPs via binary constraints (xi^2 - xi = 0)
+    void eraseSquareOneSups(const class VarFlags & flags, vector<class supSet> & BaSups); //delete the supports from Polynomial SDPs via Square-One constraints (xi^2 -1 = 0)
     void eraseCompZeroSups(class supSet & czSups, vector<class supSet> & BaSups); //delete the supports from Polynomial SDPs via complementarity constraints
     
     void disp_params();
@@ -40,29 +40,28 @@ SymamdGraph::~SymamdGraph(){
 	perm   = NULL;
 }
 
-void SymamdGraph::makeGraph(vector<vector<double> > cspmat){
+void SymamdGraph::makeGraph(const class CspGraph & graph){
 	stats = new int[COLAMD_STATS];
-	ndim = cspmat[0].size();
+	ndim = graph.ndim;
+	/* strictly lower triangular part, column by column */
 	int nnz = 0;
 	for(int i=0; i < ndim; i++){
-		for(int j=i+1; j<ndim; j++){
-			if(fabs(cspmat[j][i]) > EPS){
+		for(int k=graph.xadj[i]; k<graph.xadj[i+1]; k++){
+			if(graph.adjncy[k] > i){
 				nnz++;
 			}
 		}
 	}
 	cspnnz = nnz;
-	//printCsp(cspmat);
 	B = new int[cspnnz];
 	q = new int[ndim+1];
 	perm = new int[ndim+1];
-	//int *stats = new int[COLAMD_STATS];
 	int rownnz = 0;
 	for(int i=0; i < ndim; i++){
 		q[i] = rownnz;
-		for(int j=i+1; j< ndim; j++){
-			if(fabs(cspmat[j][i]) > EPS){
-				B[rownnz] = j;
+		for(int k=graph.xadj[i]; k<graph.xadj[i+1]; k++){
+			if(graph.adjncy[k] > i){
+				B[rownnz] = graph.adjncy[k];
 				rownnz++;
 			}
 		}
@@ -148,7 +147,7 @@ void MetisGraph::disp(){
 }
 
 
-void MetisGraph::makeGraph(vector<vector<double> > cspmat){
+void MetisGraph::makeGraph(const class CspGraph & graph){
 
 	options = new int[8];
 	options[0] = 0;
@@ -160,39 +159,20 @@ void MetisGraph::makeGraph(vector<vector<double> > cspmat){
 	options[6] = 0;
 	options[7] = 1;
 
-	ndim = cspmat[0].size();
-	int nnz  = 0;
-	int pos  = 0;
-
-	for(int i=0; i<ndim; i++){
-		for(int j=i+1; j<ndim; j++){
-			if(cspmat[i][j] != 0){
-				nnz = nnz + 1;		
-			}
-		}
-	}
+	ndim = graph.ndim;
+	int nnz = graph.nnz();
 
 	xadj   = new idxtype[ndim+1];
-	adjncy = new idxtype[2*nnz];
+	adjncy = new idxtype[nnz];
 	perm   = new idxtype[ndim];	
 	iperm  = new idxtype[ndim];
 	
-	for(int i=0; i<ndim; i++){
-		xadj[i] = pos;
-		for(int j=0; j<i; j++){
-			if(cspmat[i][j] != 0){
-				adjncy[pos] = j;	
-				pos = pos +1;
-			}
-		}
-		for(int j=i+1; j<ndim; j++){
-			if(cspmat[i][j] != 0){
-				adjncy[pos] = j;	
-				pos = pos +1;
-			}
-		}
+	for(int i=0; i<=ndim; i++){
+		xadj[i] = graph.xadj[i];
+	}
+	for(int k=0; k<nnz; k++){
+		adjncy[k] = graph.adjncy[k];
 	}
-	xadj[ndim] = pos;
 	//disp();
 }
 
@@ -202,165 +182,291 @@ void MetisGraph::findPerm(){
 	//disp();
 }
 
-void makeA(double * &A, vector<vector<double> > cspmat, vector<int> perm){
-	int ndim = cspmat[0].size();
-	int pos = 0;
-	for(int i=0; i<ndim; i++){
-		for(int j=i; j<ndim; j++){
-			A[pos] = cspmat[perm[i]][perm[j]];
-			pos = pos + 1;
-		}
-	}
-} 
-void makeExtmat(int nDim, double *A, class SparseMat & extmat){
-	int pos = 0;
-	int nnz = 0;
-	
-	vector<vector<int> > B;
-	B.resize(nDim);
-	for(int i=0; i<nDim; i++){
-		B[i].resize(nDim,0);
-	}
+CspGraph::CspGraph(){
+	ndim = 0;
+}
+
+CspGraph::~CspGraph(){
+	xadj.clear();
+	adjncy.clear();
+}
 
-	for(int i=0;i<nDim; i++){
-		for(int j=i; j<nDim; j++){
-			if(fabs(A[pos]) >EPS){
-				//cout << "A[" << pos << "]=" << A[pos] << endl;
-				if(i != j){
-					B[i][j] = 1;
-					//B[j][i] = 1;
-				}else{
-					B[i][i] = 1;
+int CspGraph::nnz() const{
+	return xadj.empty() ? 0 : xadj[ndim];
+}
+
+void CspGraph::build(const class polysystem & Polysys){
+	/* collect each edge once as (min,max), then sort and unique */
+	vector<pair<int,int> > edges;
+	vector<int> comb;
+	for(int i=0; i < Polysys.numSys; i++){
+		const class poly & Poly = Polysys.polynomial[i];
+		if(i == 0){
+			/* objective: only variables of the same nonlinear monomial interact */
+			for(list<mono>::const_iterator it = Poly.monoList.begin(); it != Poly.monoList.end(); ++it){
+				int deg = accumulate((*it).supVal.begin(), (*it).supVal.end(), 0);
+				if(deg > 1){
+					comb = (*it).supIdx;
+					intVecUnique(comb);
+					for(int a=0; a<(int)comb.size(); a++){
+						for(int b=a+1; b<(int)comb.size(); b++){
+							edges.push_back(make_pair(comb[a], comb[b]));
+						}
+					}
+				}
+			}
+		}else{
+			/* constraint: all of its variables interact */
+			comb.clear();
+			for(list<mono>::const_iterator it = Poly.monoList.begin(); it != Poly.monoList.end(); ++it){
+				comb.insert(comb.end(), (*it).supIdx.begin(), (*it).supIdx.end());
+			}
+			intVecUnique(comb);
+			for(int a=0; a<(int)comb.size(); a++){
+				for(int b=a+1; b<(int)comb.size(); b++){
+					edges.push_back(make_pair(comb[a], comb[b]));
 				}
-				nnz = nnz + 1;
 			}
-			pos = pos + 1;
 		}
 	}
-	/*
-	cout << "nnz = " << nnz << endl;
-	cout << "pos = " << pos << endl;
-	for(int i=0; i<nDim; i++){
-		for(int j=0; j<nDim; j++){
-			printf("%d ", B[i][j]);
-		}
-		printf("\n");
+	build(Polysys.dimVar, edges);
+}
+
+void CspGraph::build(int n, vector<pair<int,int> > & edges){
+	ndim = n;
+	sort(edges.begin(), edges.end());
+	edges.erase(unique(edges.begin(), edges.end()), edges.end());
+
+	xadj.assign(ndim+1, 0);
+	for(int e=0; e<(int)edges.size(); e++){
+		xadj[edges[e].first+1]++;
+		xadj[edges[e].second+1]++;
 	}
-	*/
-	extmat.resizeIr(nnz, 0);
-	extmat.resizeJc(nDim+1,0);	
-	nnz = 0;
-	for(int i=0;i<nDim; i++){
-		extmat.jc[i] = nnz;
-		for(int j=0; j<nDim; j++){
-			if(B[i][j] == 1){
-				extmat.ir[nnz] = j;
-				nnz = nnz + 1;
-			}
-		}
+	for(int i=0; i<ndim; i++){
+		xadj[i+1] += xadj[i];
 	}
-	extmat.jc[nDim] = nnz;
-	/*
-	for(int i=0; i<nnz;i++){
-		cout << "extmat.ir[" << i << "] = " << extmat.ir[i] << endl;
+	adjncy.resize(xadj[ndim]);
+	vector<int> pos(xadj.begin(), xadj.end()-1);
+	/* edges are sorted by (first,second), so every list comes out sorted */
+	for(int e=0; e<(int)edges.size(); e++){
+		adjncy[pos[edges[e].second]++] = edges[e].first;
 	}
-	for(int i=0; i<nDim+1;i++){
-		cout << "extmat.jc[" << i << "] = " << extmat.jc[i] << endl;
+	for(int e=0; e<(int)edges.size(); e++){
+		adjncy[pos[edges[e].first]++] = edges[e].second;
 	}
-	*/
 }
-/*
-void makeExtmat(double *A, vector<vector<int> > & extmat){
-	int pos = 0;
-	int ndim = extmat[0].size();
+
+void CspGraph::disp(){
+	cout << " Information of csp graph " << endl;
+	cout << " ndim = " << ndim << ", nnz = " << nnz() << endl;
 	for(int i=0; i<ndim; i++){
-		//printf("ndim = %2d\n", extmat[i].size());
-		for(int j=i; j<ndim; j++){
-			if(fabs(A[pos]) > EPS){
-				//printf("(i,j) = (%2d, %2d)\n", i,j);
-				extmat[i][j] = 1;
-				extmat[j][i] = 1;
-			}
-			pos = pos + 1;
+		cout << " " << i << ":";
+		for(int k=xadj[i]; k<xadj[i+1]; k++){
+			cout << " " << adjncy[k];
 		}
+		cout << endl;
 	}
 }
-*/
-void genCSP(class polysystem Polysys, vector<vector<double> > & cspmat){
-	
-	cspmat.resize(Polysys.dimVar);
-	for(int i=0; i<Polysys.dimVar; i++){
-		cspmat[i].resize(Polysys.dimVar,0);
-		//rv = (double)(rand()%100000)/(100000);
-		//while(fabs(rv) < EPS){
-		//	rv = (double)(rand()%100000)/(100000);
-		//}
-		//rv = (double)(1+rand()%100000)/(100000);
-		//cspmat[i][i] = cspmat[i][i] + rv; 
-		cspmat[i][i] = (double)2*6*Polysys.dimVar;
-	}	
-	
-	list<mono>::iterator it;
-	vector<poly> polyVec = Polysys.polynomial;
-	vector<int> comb,sumSupp;
-	int deg;
-	for(int i=0; i < Polysys.numSys; i++){
-		if(i == 0){
-			for(it = polyVec[0].monoList.begin(); it != polyVec[0].monoList.end();++it){
-				//deg = accumulate((*it).Supp.begin(),(*it).Supp.end(),0);
-				deg = accumulate((*it).supVal.begin(),(*it).supVal.end(),0);
-				if(deg > 1){
-					(*it).getSuppComb(comb);
-					intVecUnique(comb);
-					assignCmat(cspmat,comb);
+
+void amdOrder(const class CspGraph & graph, vector<int> & perm){
+	int n = graph.ndim;
+	perm.resize(n);
+	/* quotient graph: adjacent variables A[i], adjacent elements E[i], */
+	/* element p (created when p is eliminated) holds the variables L[p] */
+	vector<vector<int> > A(n), E(n), L(n);
+	vector<char> elim(n, 0), absorbed(n, 0);
+	vector<int> deg(n), mark(n, -1), w(n, 0), wstamp(n, -1);
+	set<pair<int,int> > heap;
+	for(int i=0; i<n; i++){
+		A[i].assign(graph.adjncy.begin()+graph.xadj[i], graph.adjncy.begin()+graph.xadj[i+1]);
+		deg[i] = A[i].size();
+		heap.insert(make_pair(deg[i], i));
+	}
+	vector<int> Lp;
+	for(int k=0; k<n; k++){
+		int p = heap.begin()->second;
+		heap.erase(heap.begin());
+		elim[p] = 1;
+		perm[k] = p;
+
+		/* new element Lp = A[p] + union of L[e], e in E[p]; those elements are absorbed */
+		Lp.clear();
+		mark[p] = p;
+		for(int a=0; a<(int)A[p].size(); a++){
+			int v = A[p][a];
+			if(!elim[v] && mark[v] != p){
+				mark[v] = p;
+				Lp.push_back(v);
+			}
+		}
+		for(int b=0; b<(int)E[p].size(); b++){
+			int e = E[p][b];
+			if(absorbed[e]) continue;
+			for(int a=0; a<(int)L[e].size(); a++){
+				int v = L[e][a];
+				if(!elim[v] && mark[v] != p){
+					mark[v] = p;
+					Lp.push_back(v);
 				}
-				/*
-				cout << "i = " << 0 << endl;
-				for(int j=0; j < comb.size(); j++){
-					cout << "comb[" << j << "]= " << comb[j] << endl;
+			}
+			absorbed[e] = 1;
+			vector<int>().swap(L[e]);
+		}
+		vector<int>().swap(A[p]);
+		vector<int>().swap(E[p]);
+		L[p] = Lp;
+
+		/* w[e] = |L[e] \ Lp| for the elements adjacent to Lp */
+		for(int a=0; a<(int)Lp.size(); a++){
+			int i = Lp[a];
+			for(int b=0; b<(int)E[i].size(); b++){
+				int e = E[i][b];
+				if(absorbed[e]) continue;
+				if(wstamp[e] != k){
+					wstamp[e] = k;
+					w[e] = L[e].size();
 				}
-				*/
-				comb.clear();
+				w[e]--;
 			}
-		}else{
-			polyVec[i].sumSupports(sumSupp);
-			for(int j = 0; j < sumSupp.size(); j++){
-				//if(sumSupp[j] != 0){
-					int v = sumSupp[j];
-					comb.push_back(v);
-				//}
+		}
+
+		/* update the variables of Lp */
+		int remaining = n - k - 1;
+		for(int a=0; a<(int)Lp.size(); a++){
+			int i = Lp[a];
+			int ne = 0;
+			int extdeg = 0;
+			for(int b=0; b<(int)E[i].size(); b++){
+				int e = E[i][b];
+				if(absorbed[e]) continue;
+				if(w[e] == 0){
+					/* L[e] is a subset of Lp: aggressive absorption */
+					absorbed[e] = 1;
+					vector<int>().swap(L[e]);
+					continue;
+				}
+				extdeg += w[e];
+				E[i][ne++] = e;
 			}
-			intVecUnique(comb);
-			assignCmat(cspmat,comb);
-			/*
-			cout << "i = " << i << endl;
-			for(int j=0; j < comb.size(); j++){
-				cout << "comb[" << j << "]= " << comb[j] << endl;
+			E[i].resize(ne);
+			E[i].push_back(p);
+			int na = 0;
+			for(int b=0; b<(int)A[i].size(); b++){
+				int v = A[i][b];
+				/* drop eliminated variables and those already covered by element p */
+				if(elim[v] || mark[v] == p) continue;
+				A[i][na++] = v;
+			}
+			A[i].resize(na);
+			extdeg += na + (int)Lp.size() - 1;
+			int d = min(remaining, min(deg[i] + (int)Lp.size(), extdeg));
+			if(d != deg[i]){
+				heap.erase(make_pair(deg[i], i));
+				deg[i] = d;
+				heap.insert(make_pair(deg[i], i));
 			}
-			*/
-			comb.clear();
 		}
 	}
-	for(int i=0; i<Polysys.dimVar; i++){
-		//cspmat[i][i] = 6*Polysys.dimVar*(double)(1+rand()%100000)/100000;
-		cspmat[i][i] = cspmat[i][i] + 5*Polysys.dimVar;
-	}	
 }
 
-void assignCmat(vector<vector<double> > & cspmat, vector<int> comb){
-	vector<int>::iterator it,it1;
-	double rv;
-	for(it = comb.begin(); it != comb.end(); ++it){
-		for(it1 = it+1; it1 != comb.end(); ++it1){
-			//rv = (double)(rand()%100000)/(100000);
-			//while(fabs(rv) < EPS){
-			//	rv = (double)(rand()%100000)/(100000);
-			//}
-			rv = (double)(1+rand()%100000)/(100000);
-			cspmat[(*it)][(*it1)] = rv;
-			cspmat[(*it1)][(*it)] = rv;
+void genMaxCliquesEtree(const class CspGraph & graph, const vector<int> & perm, class cliques & macls, bool verbose){
+	int nDim = graph.ndim;
+	vector<int> iperm(nDim);
+	for(int k=0; k<nDim; k++){
+		iperm[perm[k]] = k;
+	}
+	/* children of each column in the elimination tree (linked lists) */
+	vector<int> head(nDim, -1), next(nDim, -1), etparent(nDim, -1);
+	vector<int> mark(nDim, -1);
+	vector<vector<int> > colStruct(nDim);
+	vector<int> colClique(nDim, -1);	/* clique containing column j */
+	vector<int> repCol;			/* representative column of each clique */
+	long long nnzL = 0;
+
+	macls.clique.clear();
+	for(int j=0; j<nDim; j++){
+		/* struct(L(:,j)) = {j} + adj(j) below j + struct of children below j */
+		vector<int> & S = colStruct[j];
+		S.push_back(j);
+		mark[j] = j;
+		int v = perm[j];
+		for(int k=graph.xadj[v]; k<graph.xadj[v+1]; k++){
+			int r = iperm[graph.adjncy[k]];
+			if(r > j && mark[r] != j){
+				mark[r] = j;
+				S.push_back(r);
+			}
+		}
+		int cover = -1;
+		for(int c=head[j]; c != -1; c=next[c]){
+			for(int k=1; k<(int)colStruct[c].size(); k++){
+				int r = colStruct[c][k];
+				if(mark[r] != j){
+					mark[r] = j;
+					S.push_back(r);
+				}
+			}
+		}
+		for(int c=head[j]; c != -1; c=next[c]){
+			/* struct(c)\{c} is a subset of S; equal sizes mean c covers j */
+			if(cover < 0 && colStruct[c].size() == S.size()+1){
+				cover = c;
+			}
+		}
+		for(int c=head[j]; c != -1; c=next[c]){
+			vector<int>().swap(colStruct[c]);
 		}
+		sort(S.begin(), S.end());
+		nnzL += S.size();
+		if(S.size() > 1){
+			etparent[j] = S[1];
+			next[j] = head[S[1]];
+			head[S[1]] = j;
+		}
+		if(cover >= 0){
+			colClique[j] = colClique[cover];
+		}else{
+			colClique[j] = repCol.size();
+			repCol.push_back(j);
+			list<int> members;
+			for(int k=0; k<(int)S.size(); k++){
+				members.push_back(perm[S[k]]);
+			}
+			members.sort();
+			macls.clique.push_back(members);
+		}
+	}
+	macls.numnode = nDim;
+	macls.numcliques = macls.clique.size();
+	/* clique tree: the parent of a clique is the clique holding the first etree ancestor */
+	/* of its representative that lies outside the clique itself                      */
+	macls.parent.assign(macls.numcliques, -1);
+	for(int c=0; c<macls.numcliques; c++){
+		int pj = etparent[repCol[c]];
+		while(pj >= 0 && colClique[pj] == c){
+			pj = etparent[pj];
+		}
+		if(pj >= 0){
+			macls.parent[c] = colClique[pj];
+		}
+	}
+
+	/* statistics */
+	int maxC = 0, minC = nDim;
+	long long sumC = 0;
+	for(int c=0; c<macls.numcliques; c++){
+		int s = macls.clique[c].size();
+		maxC = max(maxC, s);
+		minC = min(minC, s);
+		sumC += s;
+	}
+	long long nnzA = graph.nnz()/2 + nDim;
+	if(verbose == false){
+		return;
 	}
+	printf("## Cliques: %d (size max %d, min %d, mean %.2f), nnz(L) = %lld, fill = %lld\n",
+		macls.numcliques, maxC, macls.numcliques > 0 ? minC : 0,
+		macls.numcliques > 0 ? (double)sumC/macls.numcliques : 0.0, nnzL, nnzL - nnzA);
 }
 
 void intVecUnique(vector<int> & ivec){
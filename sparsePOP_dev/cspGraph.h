@@ -24,13 +24,37 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
 #include "polynomials.h"
 #include "conversion.h"
 
-void makeA(double * &, vector<vector<double> >, vector<int>);
-void makeExtmat(int, double *, class SparseMat &);
-void makeExtmat(double *A, vector<vector<int> > & extmat);
-void genCSP(class polysystem, vector<vector<double> > &);
-void assignCmat(vector<vector<double> > &, vector<int>);
 void intVecUnique(vector<int> &);
 
+/* Correlative sparsity pattern graph in CSR form.           */
+/* Vertex i is variable i; i and j are adjacent when they    */
+/* appear together in a constraint or in a nonlinear monomial */
+/* of the objective function. No self loops are stored.       */
+class CspGraph{
+	public:
+		int ndim;
+		vector<int> xadj;	// adjncy[xadj[i] .. xadj[i+1]-1] are the neighbours of i
+		vector<int> adjncy;	// sorted in ascending order for each vertex
+
+	CspGraph();
+	~CspGraph();
+	void build(const class polysystem & Polysys);
+	void build(int n, vector<pair<int,int> > & edges);	// edges (i,j) with i < j; sorted in place
+	int nnz() const;
+	void disp();
+};
+
+/* Approximate minimum degree ordering of the csp graph (quotient graph with   */
+/* element absorption and AMD approximate external degrees).                 */
+/* perm[k] = variable eliminated k-th.                                        */
+void amdOrder(const class CspGraph & graph, vector<int> & perm);
+
+/* Maximal cliques of the chordal extension under the ordering perm. Column   */
+/* structures of the Cholesky factor are built along the elimination tree and */
+/* a column is a maximal clique unless a child column covers it. The clique   */
+/* tree (parent of each clique) is stored in macls.parent.                    */
+void genMaxCliquesEtree(const class CspGraph & graph, const vector<int> & perm, class cliques & macls, bool verbose = true);
+
 class MetisGraph{
 	public:
 		int ndim;
@@ -43,7 +67,7 @@ class MetisGraph{
 
 	MetisGraph();
 	~MetisGraph();
-	void makeGraph(vector<vector<double> > cspmat);
+	void makeGraph(const class CspGraph & graph);
 	void findPerm();
 	void disp();
 
@@ -60,7 +84,7 @@ class SymamdGraph{
 
 	SymamdGraph();
 	~SymamdGraph();
-	void makeGraph(vector<vector<double> > cspmat);
+	void makeGraph(const class CspGraph & graph);
 	void disp();
 };
 
@@ -45,7 +45,7 @@ Info::~Info(){
 	delete [] phase;
 }
 
-void Info::printSolutions(class s3r SDPr, string fname){
+void Info::printSolutions(const class s3r & SDPr, const string & fname){
 	if(fname.empty() == true && SDPr.param.printOnScreen == 1){
 		printf("\n\n## Computational Results by sparsePOP with SDPA ##\n");
 		//printf("## Printed by printSolustions ##\n");
@@ -399,7 +399,7 @@ void Info::printSolutions(class s3r SDPr, string fname){
 
 }
 
-void Info::CheckFeasibility(class polysystem Polysys, double & infeasError, double & scaleError){
+void Info::CheckFeasibility(const class polysystem & Polysys, double & infeasError, double & scaleError){
 	vector<double> fValue;
 	vector<double> maxAbs; 
 	/*
@@ -500,7 +500,7 @@ void Info::CheckFeasibility(class polysystem Polysys, double & infeasError, doub
 	}
 }
 
-void Info::nDimZero(class polysystem Polysys, vector<vector<double> > fixedVar){
+void Info::nDimZero(const class polysystem & Polysys, const vector<vector<double> > & fixedVar){
 	reduceAMatSW = 2;
 	xvect.resize(fixedVar[1].size());
 	for(int i=0; i<fixedVar[1].size(); i++){
@@ -522,7 +522,7 @@ void Info::nDimZero(class polysystem Polysys, vector<vector<double> > fixedVar){
 
 // if we have extended fixedVar to include added variables 
 // then hopefully this should go smoothly
-void Info::genAproximation(class poly objPoly, class polysystem Polysys, vector<double> permmatrix, vector<double> bvect, vector<double> vect, vector<vector<double> > fixedVar){
+void Info::genAproximation(const class poly & objPoly, const class polysystem & Polysys, const vector<double> & permmatrix, const vector<double> & bvect, const vector<double> & vect, const vector<vector<double> > & fixedVar){
 	vector<double> fValue;
 	vector<double> maxAbs; 
 
@@ -566,7 +566,7 @@ void Info::genAproximation(class poly objPoly, class polysystem Polysys, vector<
 	cout << "scaleError  = " << scaleError << endl;  // debug
 } 
 
-void Info::setandprintSDPInfo(class mysdp sdpdata){
+void Info::setandprintSDPInfo(const class mysdp & sdpdata){
 	ks.empty();
 	kl       = 0;
 	kf       = 0;
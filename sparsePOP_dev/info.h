@@ -79,12 +79,12 @@ class Info{
 		Info();
 		~Info();	
 	
-		void setandprintSDPInfo(class mysdp sdpdata);
-		void genAproximation(class poly objPoly, class polysystem Polysys, vector<double> permmatrix, vector<double> bvect, vector<double> xvect, vector<vector<double> > fixedVar); 
-		void printSolutions(class s3r, string fname);
-		void nDimZero(class polysystem Polysys, vector<vector<double> > fixedVar);
+		void setandprintSDPInfo(const class mysdp & sdpdata);
+		void genAproximation(const class poly & objPoly, const class polysystem & Polysys, const vector<double> & permmatrix, const vector<double> & bvect, const vector<double> & xvect, const vector<vector<double> > & fixedVar); 
+		void printSolutions(const class s3r & SDPr, const string & fname);
+		void nDimZero(const class polysystem & Polysys, const vector<vector<double> > & fixedVar);
 	
-		void CheckFeasibility(class polysystem Polysys, double & infeasibleError, double & scaleError);
+		void CheckFeasibility(const class polysystem & Polysys, double & infeasibleError, double & scaleError);
 };
 
 #endif // __info_h__
@@ -42,8 +42,6 @@ tuple<int,int, vector<int>, vector<int>, vector<int>> loadBlob(const string& fil
 
 void inputGMS(class polysystem &,string &);
 void readParam(class pop_params &, string, int);
-void genCSP(class polysystem, vector<vector<double> > &);
-void assignCmat(vector<vector<double> > &, vector<int>);
 void intVecUnique(vector<int> &);
 void set_binaryVars(class polysystem &, int, vector<string>, vector<string>);
 #endif // __input_h__
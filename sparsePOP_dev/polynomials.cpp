@@ -83,7 +83,7 @@ int mono::lengthSupp(){
 int mono::lengthCoef(){
     return Coef.size();
 }
-double mono::evalMono(vector<double> const Var){
+double mono::evalMono(const vector<double> & Var) const {
     double value=1;
     for(int i=0;i<supIdx.size();i++){
         value*= pow(Var[supIdx[i]], supVal[i]);
@@ -104,7 +104,7 @@ int mono::getSupp(int noterm){
     }
     return 0;
 }
-double mono::getCoef(int nof){
+double mono::getCoef(int nof) const {
     if(Coef.empty()){
         return 0;
     }else if(nof < 0 || nof >= Coef.size()){
@@ -344,7 +344,7 @@ void poly::writePolyData(){
     }
 }
 //evaluate the values of poly. for the specific numerical values.
-void poly::evalPoly(vector<double> const Var, vector<double> & fValue, vector<double> & maxAbs){
+void poly::evalPoly(const vector<double> & Var, vector<double> & fValue, vector<double> & maxAbs) const {
 
     if(Var.size()!=dimVar){
         cout<<"error:not num o variable == dimVar @evalPoly"<<endl;
@@ -359,7 +359,7 @@ void poly::evalPoly(vector<double> const Var, vector<double> & fValue, vector<do
         fValue.resize(sizeCone, 0.0);
         maxAbs.resize(sizeCone, 0.0);
         
-        list<class mono>::iterator Mono=monoList.begin();
+        list<class mono>::const_iterator Mono=monoList.begin();
         for(;Mono!=monoList.end();++Mono){
             mValue=(*Mono).evalMono(Var);
             for(int row=0;row<sizeCone;row++){
@@ -381,7 +381,7 @@ void poly::evalPoly(vector<double> const Var, vector<double> & fValue, vector<do
         fValue.resize(sizeCone, 0.0);
         maxAbs.resize(1, 0.0);
         
-        list<class mono>::iterator Mono=monoList.begin();
+        list<class mono>::const_iterator Mono=monoList.begin();
         for(;Mono!=monoList.end();++Mono){
             mValue=(*Mono).evalMono(Var);
             norm=0;
@@ -410,7 +410,7 @@ void poly::evalPoly(vector<double> const Var, vector<double> & fValue, vector<do
         fValue.resize(length, 0.0);
         maxAbs.resize(1, 0.0);
         
-        list<class mono>::iterator Mono=monoList.begin();
+        list<class mono>::const_iterator Mono=monoList.begin();
         for(;Mono!=monoList.end();++Mono){
             mValue=(*Mono).evalMono(Var);
             norm=0;
@@ -604,7 +604,7 @@ void bounds::allocLo(int no){
 void bounds::setLow(int novar, double lvalue){
     lower[novar-1]=lvalue;
 }
-double bounds::lbd(int i){
+double bounds::lbd(int i) const {
     if(lower.empty()){
         return 0;
     }else if( i < 0 || i >= lower.size() ){
@@ -616,7 +616,7 @@ double bounds::lbd(int i){
         return lower[i];
     }
 }
-double bounds::ubd(int i){
+double bounds::ubd(int i) const {
     if(upper.empty()){
         return 0;
     }else if( i < 0 || i>= upper.size() ){
@@ -955,7 +955,7 @@ int polysystem::polySizeCone(int nop){
     return polynomial[nop].sizecone();
 }
 
-void polysystem::evalPolynomials(vector<double> const Var, vector<double> & fValue, vector<double> & maxAbs){
+void polysystem::evalPolynomials(const vector<double> & Var, vector<double> & fValue, vector<double> & maxAbs){
     
     for(int i=0;i<this->numsys();i++){
         vector<double> fDummy;
@@ -44,6 +44,12 @@ public:
     mono(){//constructor
         nDim = -1;
     };
+    // the user-declared destructor suppresses the implicit move operations;
+    // default them so lists/vectors of monomials relocate without copying
+    mono(const mono &) = default;
+    mono(mono &&) = default;
+    mono & operator=(const mono &) = default;
+    mono & operator=(mono &&) = default;
     /*
      * mono(const mono& Mono){//copy constructor
      * supIdx.resize(Mono.supIdx.size());
@@ -78,13 +84,13 @@ public:
     
     //Return the information of mono
     int	getSupp(int nov);//return the position nov of the support
-    double getCoef(int nof);//return the position nof of the coef
+    double getCoef(int nof) const;//return the position nof of the coef
     int	lengthSupp();	//return the length of the support vector
     int lengthNzSupp();//return the # of nonzero in the support
     int	lengthCoef();//return the length of the coef vector
     int lengthNzCoef();//return the # of nonzero in the coef
     //return the value of mono for the given numeric vector.
-    double evalMono(vector<double> const Var);
+    double evalMono(const vector<double> & Var) const;
     void getSuppComb(vector<int> & comb);
     void copyCoef(vector<double> & coef);
     void getSup(class sup & Sup);
@@ -132,6 +138,10 @@ public:
 		}
 		monoList.clear();
 	};
+	poly(const poly &) = default;
+	poly(poly &&) = default;
+	poly & operator=(const poly &) = default;
+	poly & operator=(poly &&) = default;
 	/*
 	* poly Copy(const poly& P){//copy function
 	* if(this == &P){
@@ -193,7 +203,7 @@ public:
 	void writePolyData();
 
 	//return the values of poly. for the given numeric vector.
-	void evalPoly(vector<double> const var, vector<double> & xVect, vector<double> & maxAbs);
+	void evalPoly(const vector<double> & var, vector<double> & xVect, vector<double> & maxAbs) const;
 	//devides all coefficients by scaleValue
 	void scalingPoly(double & ScaleValue, double maxCoef);
 	void getConst(vector<double> & constValue, int isErase=YES);
@@ -218,6 +228,10 @@ public:
         upper.clear();
         lower.clear();
     };
+    bounds(const bounds &) = default;
+    bounds(bounds &&) = default;
+    bounds & operator=(const bounds &) = default;
+    bounds & operator=(bounds &&) = default;
     /*
      * bounds Copy(const bounds& B){
      * if(this == &B){
@@ -239,8 +253,8 @@ public:
     void allocLo(int no);	//allocate the lower bound.
     void allocUpLo(int no);	//allocate the upper and lower bound
     void setLow(int novar, double lvalue);	//Input the lower bound of novar-the variable.
-    double lbd(int i);	//return the lower bound of i-th variable
-    double ubd(int i);	//return the upper bound of i-th variable
+    double lbd(int i) const;	//return the lower bound of i-th variable
+    double ubd(int i) const;	//return the upper bound of i-th variable
     void printdata();	//display bounds.
     void clear();
 };
@@ -318,6 +332,10 @@ public:
 		bounds.clear();
 		boundsNew.clear();
 	};
+	polysystem(const polysystem &) = default;
+	polysystem(polysystem &&) = default;
+	polysystem & operator=(const polysystem &) = default;
+	polysystem & operator=(polysystem &&) = default;
 	/*
 	* polysystem Copy(const polysystem& P){
 	* if(this == &P){
@@ -358,7 +376,7 @@ public:
 	void writePolynomials();				//display POP.
 	void addPoly(class poly & Poly);			//add Poly into POP.
 	//values of constriants of POP for the given numeric vector
-	void evalPolynomials(vector<double> const Var, vector<double>& fValue, vector<double> & maxAbs);
+	void evalPolynomials(const vector<double> & Var, vector<double>& fValue, vector<double> & maxAbs);
     
 	int polyDimvar(int nop);	//return the dimension of nop-th poly.
 	int polyNoterms(int nop);	//return the # of monomials of nop-th poly.
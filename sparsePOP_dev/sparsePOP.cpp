@@ -213,13 +213,11 @@ void makeSDPr(class s3r &POP, class mysdp & sdpdata, class Info & info, string &
 		cout << "# We multiply -1 into the objective fuction for" << endl; 
 		cout << "# converting it into the minimization problem." << endl;
 	}
-    POP.objPoly = POP.Polysys.polynomial[0];
     POP.detailedInfFile = POP.param.detailedInfFile;
     POP.sdpaDataFile = POP.param.sdpaDataFile;
     
-    /* save original POP */
-    POP.OriPolysys = POP.Polysys;
-    //POP.OriPolysys.writePolynomials();
+    /* the original POP is not saved: Polysys is still untouched wherever it is
+       read before conversion_part1, and a full copy doubles the list<mono> memory */
     
     int ndim = POP.Polysys.dimVar;
     fixedVar[0].resize(ndim, 0);
@@ -231,10 +229,10 @@ void makeSDPr(class s3r &POP, class mysdp & sdpdata, class Info & info, string &
     POP.degOneTerms.resize(POP.Polysys.dimVar, 0);
     if(POP.Polysys.dimVar == 0){
         //cout << POP.Polysys.dimVar << endl;
-        info.nDimZero(POP.OriPolysys, fixedVar);
+        info.nDimZero(POP.Polysys, fixedVar);
         vector<double> fValue;
         vector<double> maxAbs;
-        POP.OriPolysys.polynomial[0].evalPoly(info.xvect, fValue, maxAbs);
+        POP.Polysys.polynomial[0].evalPoly(info.xvect, fValue, maxAbs);
         info.objValue = fValue[0];
         if(info.infeasibleSW == 2 || info.infeasibleSW == -2){
             return;
@@ -243,10 +241,10 @@ void makeSDPr(class s3r &POP, class mysdp & sdpdata, class Info & info, string &
     double objconst;
     int slen = POP.Polysys.numSys;
     int blen = POP.Polysys.dimVar;
-    int mlen = POP.Polysys.dimVar * POP.Polysys.dimVar;
+    int mlen = POP.Polysys.dimVar; // diagonal of the scaling matrix only
     vector<double> scalevalue(slen);
     vector<double> bvect(blen);
-    vector<double> permmatrix(mlen);
+    vector<double> permmatrix(mlen, 1.0);
     
     conversion_part1(POP, objconst,
             slen, scalevalue,
@@ -254,29 +252,31 @@ void makeSDPr(class s3r &POP, class mysdp & sdpdata, class Info & info, string &
             mlen, permmatrix);
     //cout << "conversion1 finished. " << endl;
     //POP.Polysys.writePolynomials();
-    POP.scalevalue = scalevalue;
-    POP.bvect = bvect;
-    POP.permmatrix =permmatrix;
-    //printScaleInfo(slen,blen,mlen,scalevalue,bvect,permmatrix);
-    vector<vector<double> > cspmat;
-    genCSP(POP.Polysys, cspmat);
-	//printCsp(cspmat);
+    POP.scalevalue.swap(scalevalue);
+    POP.bvect.swap(bvect);
+    POP.permmatrix.swap(permmatrix);
+    //printScaleInfo(slen,blen,mlen,POP.scalevalue,POP.bvect,POP.permmatrix);
+    class CspGraph cspgraph;
+    cspgraph.build(POP.Polysys);
+	//cspgraph.disp();
     
     vector<int> oriidx(POP.Polysys.dimVar);
     ///vector<vector<int> > extmat(POP.Polysys.dimVar);
     class SparseMat extmat;
     
     if(POP.param.sparseSW == 1){
-        if(POP.param.Method == "metis"){
+        if(POP.param.Method == "amd"){
+            amdOrder(cspgraph, oriidx);
+        }else if(POP.param.Method == "metis"){
             MetisGraph graph;
-            graph.makeGraph(cspmat);
+            graph.makeGraph(cspgraph);
             METIS_NodeND(&graph.ndim, graph.xadj, graph.adjncy, &graph.numflag, graph.options, graph.perm, graph.iperm);
             for(int i=0; i< POP.Polysys.dimVar; i++){
                 oriidx[i] = graph.perm[i];
             }
         }else if(POP.param.Method == "symamd"){
             SymamdGraph graph;
-            graph.makeGraph(cspmat);
+            graph.makeGraph(cspgraph);
             int ok = symamd(graph.ndim, graph.B, graph.q, graph.perm, (double *)NULL, graph.stats, &calloc, &free);
             //symamd_report(graph.stats);
 			if(ok != 1){
@@ -289,32 +289,11 @@ void makeSDPr(class s3r &POP, class mysdp & sdpdata, class Info & info, string &
             }
             //graph.disp();
         }else{
-            cout << " ## Error: Should be metis or symamd in param.Method." << endl;
+            cout << " ## Error: Should be amd, metis or symamd in param.Method." << endl;
             exit(EXIT_FAILURE);
         }
-        char UPLO = 'L';
-        int info;
-        int size = POP.Polysys.dimVar*(POP.Polysys.dimVar+1) >> 1;
-        double *A = new double[size];
-        makeA(A, cspmat, oriidx);
-        //printMat(A,POP.Polysys.dimVar);
-        
-        /* Cholesky decomposition */
-        /* Fiding chordal extension */
-        dpptrf_(&UPLO, &POP.Polysys.dimVar, A, &info);
-        if(info == 0){
-            //printMat(A,POP.Polysys.dimVar);
-            makeExtmat(POP.Polysys.dimVar, A, extmat);
-        }else if(info <0){
-            cout << " ## Error: csp matrix has something wrong." << endl;
-            exit(EXIT_FAILURE);
-        }else if(info > 0){
-            cout << " ## Error: csp matrix is not positive definite." << endl;
-            cout << "           Try to cosntruct csp matrix again." << endl;
-            exit(EXIT_FAILURE);
-        }
-        delete [] A;
-        A = NULL;
+        /* Maximal cliques of the chordal extension, read off the elimination tree */
+        genMaxCliquesEtree(cspgraph, oriidx, POP.maxcliques);
     }else if(POP.param.sparseSW == 0){
 	int nnz = POP.Polysys.dimVar^2;
 	extmat.resizeIr(nnz, 0);
@@ -20,6 +20,225 @@
  * ------------------------------------------------------------- */
 
 #include "sup.h"
+
+static unsigned long long hash_support(const int * idx, const int * val, int nnz){
+    unsigned long long h = 1469598103934665603ULL ^ (unsigned long long)nnz;
+    for(int i=0; i<nnz; i++){
+        h = (h ^ (unsigned long long)(unsigned int)idx[i]) * 1099511628211ULL;
+        h = (h ^ (unsigned long long)(unsigned int)val[i]) * 1099511628211ULL;
+    }
+    return h ^ (h >> 29);
+}
+
+void VarFlags::init(int dimVar){
+    flag.assign(dimVar, 0);
+}
+void VarFlags::set(const vector<int> & vars, unsigned char f){
+    for(int i=0; i<(int)vars.size(); i++){
+        if(vars[i] >= (int)flag.size()){
+            flag.resize(vars[i]+1, 0);
+        }
+        if(vars[i] >= 0){
+            flag[vars[i]] |= f;
+        }
+    }
+}
+int VarFlags::count(unsigned char f) const{
+    int num = 0;
+    for(int i=0; i<(int)flag.size(); i++){
+        if(flag[i] & f){
+            num++;
+        }
+    }
+    return num;
+}
+bool VarFlags::allBinary() const{
+    if(flag.empty()){
+        return false;
+    }
+    for(int i=0; i<(int)flag.size(); i++){
+        if((flag[i] & BINARY) == 0 || (flag[i] & SQUAREONE) != 0){
+            return false;
+        }
+    }
+    return true;
+}
+void VarFlags::disp() const{
+    cout << "## Variable flags: " << flag.size() << " variables, binary = " << count(BINARY)
+         << ", squareOne = " << count(SQUAREONE) << ", complementarity = " << count(COMPLEMENT)
+         << ", observed = " << count(OBSERVED) << endl;
+}
+
+SupportArena::SupportArena(){
+    ptr.assign(1, 0);
+    mask = 0;
+}
+void SupportArena::clear(){
+    ptr.assign(1, 0);
+    idx.clear();
+    val.clear();
+    hash.clear();
+    deg.clear();
+    table.clear();
+    mask = 0;
+}
+int SupportArena::size() const {
+    return ptr.size() - 1;
+}
+void SupportArena::push(const class sup & Sup){
+    int nnz = Sup.idx.size();
+    idx.insert(idx.end(), Sup.idx.begin(), Sup.idx.end());
+    val.insert(val.end(), Sup.val.begin(), Sup.val.end());
+    ptr.push_back(idx.size());
+    hash.push_back(hash_support(Sup.idx.data(), Sup.val.data(), nnz));
+    deg.push_back(accumulate(Sup.val.begin(), Sup.val.end(), 0));
+}
+void SupportArena::assign(const list<class sup> & supList){
+    clear();
+    int nnz = 0;
+    for(list<class sup>::const_iterator ite = supList.begin(); ite != supList.end(); ++ite){
+        nnz += (*ite).idx.size();
+    }
+    ptr.reserve(supList.size()+1);
+    idx.reserve(nnz);
+    val.reserve(nnz);
+    hash.reserve(supList.size());
+    deg.reserve(supList.size());
+    for(list<class sup>::const_iterator ite = supList.begin(); ite != supList.end(); ++ite){
+        push(*ite);
+    }
+}
+void SupportArena::get(int s, class sup & Sup) const {
+    Sup.idx.assign(idx.begin()+ptr[s], idx.begin()+ptr[s+1]);
+    Sup.val.assign(val.begin()+ptr[s], val.begin()+ptr[s+1]);
+}
+void SupportArena::buildIndex(){
+    int n = size();
+    unsigned long long cap = 16;
+    while(cap < 2*(unsigned long long)n){
+        cap <<= 1;
+    }
+    mask = cap - 1;
+    table.assign(cap, -1);
+    for(int s=0; s<n; s++){
+        unsigned long long h = hash[s] & mask;
+        while(table[h] >= 0){
+            if(equal(table[h], s)){
+                break;
+            }
+            h = (h + 1) & mask;
+        }
+        if(table[h] < 0){
+            table[h] = s;
+        }
+    }
+}
+int SupportArena::find(const class sup & Sup) const {
+    if(table.empty()){
+        return -1;
+    }
+    int nnz = Sup.idx.size();
+    unsigned long long hs = hash_support(Sup.idx.data(), Sup.val.data(), nnz);
+    unsigned long long h = hs & mask;
+    while(table[h] >= 0){
+        int s = table[h];
+        if(hash[s] == hs && ptr[s+1]-ptr[s] == nnz
+           && std::equal(Sup.idx.begin(), Sup.idx.end(), idx.begin()+ptr[s])
+           && std::equal(Sup.val.begin(), Sup.val.end(), val.begin()+ptr[s])){
+            return s;
+        }
+        h = (h + 1) & mask;
+    }
+    return -1;
+}
+bool SupportArena::contains(const class sup & Sup) const {
+    return find(Sup) >= 0;
+}
+bool SupportArena::equal(int a, int b) const {
+    int na = ptr[a+1]-ptr[a];
+    if(hash[a] != hash[b] || na != ptr[b+1]-ptr[b]){
+        return false;
+    }
+    return std::equal(idx.begin()+ptr[a], idx.begin()+ptr[a+1], idx.begin()+ptr[b])
+        && std::equal(val.begin()+ptr[a], val.begin()+ptr[a+1], val.begin()+ptr[b]);
+}
+bool SupportArena::less(int a, int b) const {
+    int na = ptr[a+1]-ptr[a];
+    int nb = ptr[b+1]-ptr[b];
+    if(na != 0 && nb == 0){
+        return false;
+    }else if(nb != 0 && na == 0){
+        return true;
+    }
+    if(deg[a] != deg[b]){
+        return (deg[a] < deg[b]);
+    }
+    const int * ia = &idx[0] + ptr[a];
+    const int * ib = &idx[0] + ptr[b];
+    const int * va = &val[0] + ptr[a];
+    const int * vb = &val[0] + ptr[b];
+    int m = min(na, nb);
+    for(int i=0; i<m; i++){
+        if(ia[i] != ib[i]){
+            return (ia[i] < ib[i]);
+        }
+        if(va[i] != vb[i]){
+            return (vb[i] < va[i]);
+        }
+    }
+    return false;
+}
+void SupportArena::sortedOrder(vector<int> & order) const {
+    int n = size();
+    /* counting sort on the leading key (empty support first, then degree) */
+    vector<int> key(n);
+    int maxKey = 0;
+    for(int s=0; s<n; s++){
+        key[s] = (ptr[s+1] == ptr[s]) ? 0 : deg[s] + 1;
+        maxKey = max(maxKey, key[s]);
+    }
+    vector<int> start(maxKey+2, 0);
+    for(int s=0; s<n; s++){
+        start[key[s]+1]++;
+    }
+    for(int k=0; k<=maxKey; k++){
+        start[k+1] += start[k];
+    }
+    order.resize(n);
+    vector<int> pos(start.begin(), start.end()-1);
+    for(int s=0; s<n; s++){
+        order[pos[key[s]]++] = s;
+    }
+    /* then a stable sort inside each bucket, split into chunks for the threads */
+    const int chunk = 1 << 14;
+    vector<pair<int,int> > ranges;
+    for(int k=0; k<=maxKey; k++){
+        for(int b=start[k]; b<start[k+1]; b+=chunk){
+            ranges.push_back(make_pair(b, min(b+chunk, start[k+1])));
+        }
+    }
+    #pragma omp parallel for schedule(dynamic)
+    for(int r=0; r<(int)ranges.size(); r++){
+        stable_sort(order.begin()+ranges[r].first, order.begin()+ranges[r].second,
+            [this](int a, int b){ return less(a, b); });
+    }
+    for(int k=0; k<=maxKey; k++){
+        for(int width=chunk; start[k]+width < start[k+1]; width*=2){
+            int first = start[k];
+            int numMerges = (start[k+1]-first + 2*width-1) / (2*width);
+            #pragma omp parallel for schedule(dynamic)
+            for(int m=0; m<numMerges; m++){
+                int lo = first + m*2*width;
+                int mid = min(lo+width, start[k+1]);
+                int hi = min(lo+2*width, start[k+1]);
+                if(mid < hi){
+                    inplace_merge(order.begin()+lo, order.begin()+mid, order.begin()+hi,
+                        [this](int a, int b){ return less(a, b); });
+                }
+            }
+        }
+    }
+}
 bool comp_sup(class sup & sup1, class sup & sup2){
 	return (sup1 < sup2);
 }
@@ -79,7 +298,20 @@ bool sup::operator <(const class sup & t)const {
     return false;
 }
 void supSet::sort(){
-    supList.sort(comp_sup);
+    class SupportArena arena;
+    arena.assign(supList);
+    vector<int> order;
+    arena.sortedOrder(order);
+    vector<list<class sup>::iterator> pos;
+    pos.reserve(supList.size());
+    for(list<class sup>::iterator ite = supList.begin(); ite != supList.end(); ++ite){
+        pos.push_back(ite);
+    }
+    list<class sup> sorted;
+    for(int k=0; k<(int)order.size(); k++){
+        sorted.splice(sorted.end(), supList, pos[order[k]]);
+    }
+    supList.swap(sorted);
 }
 sup::sup(){
     idx.resize(0);
@@ -368,19 +600,24 @@ void genLexAll(int totalOfVars, int Deg, list<class sup> & supList){
 }
 
 void supSet::unique(){
-    //cout << endl;
-    //cout << " Size of supList = " << supList.size() << endl;
-    set<sup> ret;
-    
-    for(list<sup>::iterator ite = supList.begin();ite != supList.end();++ite){
-        ret.insert(*ite);
+    /* same result as inserting into set<sup>: ascending order, one copy each */
+    class SupportArena arena;
+    arena.assign(supList);
+    vector<int> order;
+    arena.sortedOrder(order);
+    vector<list<class sup>::iterator> pos;
+    pos.reserve(supList.size());
+    for(list<class sup>::iterator ite = supList.begin(); ite != supList.end(); ++ite){
+        pos.push_back(ite);
     }
-    supList.clear();
-    for(set<sup>::iterator ite = ret.begin();ite != ret.end();++ite){
-        supList.push_back(*ite);
+    list<class sup> sorted;
+    for(int k=0; k<(int)order.size(); k++){
+        if(k > 0 && arena.equal(order[k-1], order[k])){
+            continue;
+        }
+        sorted.splice(sorted.end(), supList, pos[order[k]]);
     }
-    //cout << " Size of supList = " << supList.size() << endl;
-    //cout << endl;
+    supList.swap(sorted);
 }
 void supSet::pushSup(class sup & newSup) {
     this->supList.push_back(newSup);
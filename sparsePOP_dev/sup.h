@@ -71,6 +71,39 @@ public:
 		return (*a < *b);
 	};
 };
+/* Packed set of supports: support s owns idx/val[ptr[s] .. ptr[s+1]). */
+/* Gives hash membership and sorting in the order of sup::operator<     */
+/* without touching the per-support vectors of a list<sup>.             */
+class SupportArena{
+public:
+    vector<int> ptr;
+    vector<int> idx;
+    vector<int> val;
+    vector<unsigned long long> hash;
+    vector<int> deg;
+    
+    SupportArena();
+    void clear();
+    int size() const;
+    void push(const class sup & Sup);
+    void assign(const list<class sup> & supList);
+    void get(int s, class sup & Sup) const;
+    
+    // hash membership; buildIndex() must follow the last push
+    void buildIndex();
+    int find(const class sup & Sup) const;
+    bool contains(const class sup & Sup) const;
+    
+    bool equal(int a, int b) const;
+    bool less(int a, int b) const;	// same order as sup::operator<
+    // positions of the supports in ascending order (stable)
+    void sortedOrder(vector<int> & order) const;
+    
+private:
+    vector<int> table;	// open addressing, -1 = empty
+    unsigned long long mask;
+};
+
 class supSet{
 public:
     int dimVar;
@@ -169,4 +202,41 @@ public:
 	void removeEQU(int num, vector<int> remainIdx);
 };
 
+/* Per-variable properties of the polynomial system, built once from   */
+/* the binary (xi^2 - xi = 0), square-one (xi^2 - 1 = 0) and           */
+/* complementarity constraints, and shared by the support erasure, the */
+/* objective cleanup and the streaming writer.                         */
+class VarFlags{
+public:
+    enum { BINARY = 1, SQUAREONE = 2, COMPLEMENT = 4, OBSERVED = 8 };
+    vector<unsigned char> flag;
+
+    void init(int dimVar);
+    void set(const vector<int> & vars, unsigned char f);
+    int size() const { return (int)flag.size(); }
+    bool has(int v, unsigned char f) const {
+        return v >= 0 && v < (int)flag.size() && (flag[v] & f) != 0;
+    }
+    bool isBinary(int v) const { return has(v, BINARY); }
+    bool isSquareOne(int v) const { return has(v, SQUAREONE); }
+    // exponent of xi after applying xi^2 = xi and xi^2 = 1
+    int reduce(int v, int exp) const {
+        if(v < 0 || v >= (int)flag.size()){
+            return exp;
+        }
+        if((flag[v] & BINARY) && exp > 1){
+            return 1;
+        }
+        if(flag[v] & SQUAREONE){
+            return exp % 2;
+        }
+        return exp;
+    }
+    int count(unsigned char f) const;
+    bool any(unsigned char f) const { return count(f) > 0; }
+    // every variable is binary and none is square-one
+    bool allBinary() const;
+    void disp() const;
+};
+
 #endif /* #ifndef _SUP_ */
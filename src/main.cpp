@@ -1,6 +1,7 @@
 #include <iostream>
 #include <fstream>
 #include <cmath>
+#include <cctype>
 #include <typeinfo> // for debugging, can remove later
 
 #include "config.h"
@@ -40,6 +41,21 @@ int main(int argc, char** argv) {
             fixedEnzyme = argv[++i];
         } else if (arg == "--fileName" && i + 1 < argc) {
             DATA_FILE = argv[++i];
+        } else if (arg == "--check-sdpb" && i + 1 < argc) {
+            // validate a binary SDP container and exit
+            return check_sdpb_file(argv[++i]) ? 0 : 1;
+        } else if (arg == "--check-cbf" && i + 2 < argc) {
+            // compare a CBF file with the SDPA / .sdpb encoding of the same problem
+            return check_cbf_equivalence(argv[i + 1], argv[i + 2]) ? 0 : 1;
+        } else if (arg == "--bench-monomial-map") {
+            // monomial map microbenchmark: --bench-monomial-map [vars keys]
+            int num_vars = 2000, num_keys = 2000000;
+            if (i + 2 < argc && std::isdigit((unsigned char)argv[i + 1][0]) && std::isdigit((unsigned char)argv[i + 2][0])) {
+                num_vars = std::atoi(argv[i + 1]);
+                num_keys = std::atoi(argv[i + 2]);
+            }
+            bench_monomial_map(num_vars, num_keys);
+            return 0;
         }
     }   
 
@@ -33,6 +33,46 @@ std::string human_bytes(std::size_t b) {
     return std::string(buf);
 }
 
+double wall_seconds() {
+    using Clock = std::chrono::steady_clock;
+    return std::chrono::duration<double>(Clock::now().time_since_epoch()).count();
+}
+
+static std::vector<StageRecord>& stage_list() {
+    static std::vector<StageRecord> stages;
+    return stages;
+}
+
+void record_stage(const std::string& name, double seconds,
+                  std::size_t rss_start, std::size_t rss_end, std::size_t peak_end) {
+    stage_list().push_back(StageRecord{name, seconds, rss_start, rss_end, peak_end});
+}
+
+const std::vector<StageRecord>& stage_times() {
+    return stage_list();
+}
+
+// time, then RSS at the end of the stage, its change over the stage and the peak so far
+void print_stages(std::ostream& os) {
+    double total = 0.0;
+    for (const auto& s : stage_list()) total += s.seconds;
+    for (const auto& s : stage_list()) {
+        char buf[192];
+        if (s.rss_end > 0) {
+            double delta = (static_cast<double>(s.rss_end) - static_cast<double>(s.rss_start)) / (1024.0 * 1024.0);
+            std::snprintf(buf, sizeof(buf), "[Stage] %-28s %9.3fs | RSS=%s (%+.2f MiB) | Peak=%s",
+                          s.name.c_str(), s.seconds, human_bytes(s.rss_end).c_str(), delta,
+                          human_bytes(s.peak_end).c_str());
+        } else {
+            std::snprintf(buf, sizeof(buf), "[Stage] %-28s %9.3fs", s.name.c_str(), s.seconds);
+        }
+        os << buf << '\n';
+    }
+    char buf[96];
+    std::snprintf(buf, sizeof(buf), "[Stage] %-28s %9.3fs", "total", total);
+    os << buf << '\n';
+}
+
 
 Checkpoint::Checkpoint(std::string label)
     : start_(Clock::now()), last_(start_), label_(std::move(label)) {
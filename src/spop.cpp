@@ -30,6 +30,7 @@ void solveWithSparsePOP(std::string& gmsFilePath, std::tuple<int,int, std::vecto
     std::vector<std::vector<double>> fixedVar(2);
     makeSDPr(POP, sdpdata, info, gmsFilePath, fixedVar, fromGen);
     cp.tick("SDP Conversion Complete");
+    metrics::print_stages();
 
 
     std::cout << "\n=== SDP Problem Info ===" << std::endl;
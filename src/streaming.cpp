@@ -1,17 +1,36 @@
 #include "streaming.h"
 #include "spvec.h"
+#include "sup.h"
 #include "global.h"
+#include "metrics.h"
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <map>
 #include <algorithm>
 #include <cmath>
+#include <cstdlib>
 #include <unordered_set>
-
-
-// Add this helper function at the top of streaming.cpp (after includes)
+#include <random>
+#include <charconv>
+#include <bitset>
+#include <omp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+// Append (var, exp) after the binary / square-one reduction (x^2 = x, x^2 = 1);
+// terms whose exponent becomes 0 are dropped. A null flags pointer reduces nothing.
+static inline void push_reduced(MonomialKey& key, int var, int exp, const VarFlags* flags) {
+    if (flags != nullptr) exp = flags->reduce(var, exp);
+    if (exp != 0) key.push_back(var, exp);
+}
 
 // Merge two monomials by adding exponents (polynomial multiplication)
-// Returns a MonomialKey representing the product
-MonomialKey merge_monomials(const spvec_array& sup1, int idx1, const spvec_array& sup2, int idx2) {
+// Returns a MonomialKey representing the product, reduced by flags
+MonomialKey merge_monomials(const spvec_array& sup1, int idx1, const spvec_array& sup2, int idx2, const VarFlags* flags) {
     MonomialKey result;
     
     int pos1 = sup1.pnz[0][idx1];
@@ -20,80 +39,61 @@ MonomialKey merge_monomials(const spvec_array& sup1, int idx1, const spvec_array
     int max2 = pos2 + sup2.pnz[1][idx2];
     
     // Handle empty cases
-    if (pos1 < 0 && pos2 < 0) return result;  // Both empty
-    if (pos1 < 0) { //only second monomial
-        for (int i = pos2; i < max2; i++) {
-            result.terms.emplace_back(sup2.vap[0][i], sup2.vap[1][i]);
-        }
-        return result;
-    }
-    
-    if (pos2 < 0) { // only first monomial
-        for (int i = pos1; i < max1; i++) {
-            result.terms.emplace_back(sup1.vap[0][i], sup1.vap[1][i]);
-        }
-        return result;
-    }
+    if (pos1 < 0) pos1 = max1 = 0;
+    if (pos2 < 0) pos2 = max2 = 0;
     
     // Merge both (sorted merge, adding exponents for matching vars)
     while (pos1 < max1 && pos2 < max2) {
         if (sup1.vap[0][pos1] < sup2.vap[0][pos2]) {
-            result.terms.emplace_back(sup1.vap[0][pos1], sup1.vap[1][pos1]);
+            push_reduced(result, sup1.vap[0][pos1], sup1.vap[1][pos1], flags);
             pos1++;
         } else if (sup1.vap[0][pos1] > sup2.vap[0][pos2]) {
-            result.terms.emplace_back(sup2.vap[0][pos2], sup2.vap[1][pos2]);
+            push_reduced(result, sup2.vap[0][pos2], sup2.vap[1][pos2], flags);
             pos2++;
         } else { // same variable -> add exponents
-            result.terms.emplace_back(sup1.vap[0][pos1], sup1.vap[1][pos1] + sup2.vap[1][pos2]);
+            push_reduced(result, sup1.vap[0][pos1], sup1.vap[1][pos1] + sup2.vap[1][pos2], flags);
             pos1++;
             pos2++;
         }
     }
     while (pos1 < max1) {
-        result.terms.emplace_back(sup1.vap[0][pos1], sup1.vap[1][pos1]);
+        push_reduced(result, sup1.vap[0][pos1], sup1.vap[1][pos1], flags);
         pos1++;
     }
     while (pos2 < max2) {
-        result.terms.emplace_back(sup2.vap[0][pos2], sup2.vap[1][pos2]);
+        push_reduced(result, sup2.vap[0][pos2], sup2.vap[1][pos2], flags);
         pos2++;
     }
     return result;
 }
 
-// Merge a MonomialKey with a monomial from spvec_array
-MonomialKey merge_key_with_mono(const MonomialKey& key, const spvec_array& sup, int idx) {
+// Merge a MonomialKey with a monomial from spvec_array, reduced by flags
+MonomialKey merge_key_with_mono(const MonomialKey& key, const spvec_array& sup, int idx, const VarFlags* flags) {
     MonomialKey result;
-    int pos2 = sup.pnz[0][idx];
-    int max2 = pos2 + sup.pnz[1][idx];
-    if (pos2 < 0) return key;  // sup is empty, return key as-is
-    if (key.terms.empty()) {
-        // key is empty, just copy from sup
-        for (int i = pos2; i < max2; i++) {
-            result.terms.emplace_back(sup.vap[0][i], sup.vap[1][i]);
-        }
-        return result;
-    }
+    int p = sup.pnz[0][idx];
+    int max2 = p + sup.pnz[1][idx];
+    if (p < 0) p = max2 = 0;
     
     // Merge sorted lists
-    size_t k = 0;
-    int p = pos2;
-    while (k < key.terms.size() && p < max2) {
-        if (key.terms[k].first < sup.vap[0][p]) {
-            result.terms.push_back(key.terms[k]);
+    int k = 0;
+    while (k < key.size && p < max2) {
+        if (key.var(k) < sup.vap[0][p]) {
+            push_reduced(result, key.var(k), key.exp(k), flags);
             k++;
-        } else if (key.terms[k].first > sup.vap[0][p]) {
-            result.terms.emplace_back(sup.vap[0][p], sup.vap[1][p]);
+        } else if (key.var(k) > sup.vap[0][p]) {
+            push_reduced(result, sup.vap[0][p], sup.vap[1][p], flags);
             p++;
         } else {
-            result.terms.emplace_back(key.terms[k].first, key.terms[k].second + sup.vap[1][p]);
+            push_reduced(result, key.var(k), key.exp(k) + sup.vap[1][p], flags);
             k++; p++;
         }
     }
-    while (k < key.terms.size()) {
-        result.terms.push_back(key.terms[k++]);
+    while (k < key.size) {
+        push_reduced(result, key.var(k), key.exp(k), flags);
+        k++;
     }
     while (p < max2) {
-        result.terms.emplace_back(sup.vap[0][p], sup.vap[1][p]);
+        push_reduced(result, sup.vap[0][p], sup.vap[1][p], flags);
         p++;
     }
     return result;
@@ -103,36 +103,29 @@ MonomialKey::MonomialKey(const spvec_array& sups, int monomial_idx) {
     // Get the range for this monomial in vap
     int start = sups.pnz[0][monomial_idx];
     int nnz = sups.pnz[1][monomial_idx];
+    if (start < 0) return;
     
-    terms.reserve(nnz);
-    for (int i = 0; i < nnz; i++) {
-        int var_idx = sups.vap[0][start + i];
-        int exponent = sups.vap[1][start + i];
-        terms.emplace_back(var_idx, exponent);
+    // Supports are normally sorted by variable index; sort a copy otherwise
+    bool sorted = true;
+    for (int i = 1; i < nnz; i++) {
+        if (sups.vap[0][start + i - 1] > sups.vap[0][start + i]) { sorted = false; break; }
     }
-    // Ensure sorted by variable index for consistent hashing
-    std::sort(terms.begin(), terms.end());
-}
-
-int simplify_exponent(int var_idx, int exponent,  const std::vector<int>& binvec,  const std::vector<int>& Sqvec) {
-    for (int bv : binvec) {
-        if (var_idx == bv && exponent > 1) return 1;
-    }
-    for (int sv : Sqvec) {
-        if (var_idx == sv) return exponent % 2;
+    if (sorted) {
+        for (int i = 0; i < nnz; i++) push_back(sups.vap[0][start + i], sups.vap[1][start + i]);
+        return;
     }
-    return exponent;
+    std::vector<std::pair<int, int>> terms(nnz);
+    for (int i = 0; i < nnz; i++) terms[i] = std::make_pair(sups.vap[0][start + i], sups.vap[1][start + i]);
+    std::sort(terms.begin(), terms.end());
+    for (const auto& t : terms) push_back(t.first, t.second);
 }
 
-void simplify_key(MonomialKey& key, const std::vector<int>& binvec, const std::vector<int>& Sqvec) {
-    for (auto& [var, exp] : key.terms) {
-        exp = simplify_exponent(var, exp, binvec, Sqvec);
-    }
-    // Remove terms with exponent 0 
-    key.terms.erase(
-        std::remove_if(key.terms.begin(), key.terms.end(),
-            [](const std::pair<int,int>& t) { return t.second == 0; }),
-        key.terms.end());
+// Key of sups[idx] with the reduction applied (and zero exponents dropped)
+static MonomialKey reduced_key(const spvec_array& sups, int idx, const VarFlags* flags) {
+    MonomialKey key(sups, idx);
+    MonomialKey result;
+    for (int t = 0; t < key.size; t++) push_reduced(result, key.var(t), key.exp(t), flags);
+    return result;
 }
 
 //=============================================================================
@@ -140,21 +133,41 @@ void simplify_key(MonomialKey& key, const std::vector<int>& binvec, const std::v
 //=============================================================================
 
 int StreamingContext::register_monomial(const MonomialKey& key) {
-    auto it = monomial_to_var.find(key);
-    if (it != monomial_to_var.end()) {
-        return it->second;
+    if (monomial_budget > 0) {
+        spill_monomial(monomial_to_var, key);
+        return 0;
     }
     // New monomial: assign next variable number (1-indexed)
-    int var_num = mDim;
-    mDim++;
-    monomial_to_var[key] = var_num;
+    int var_num = monomial_to_var.find_or_insert(key, mDim);
+    if (var_num == mDim) mDim++;
     return var_num;
 }
 
-int StreamingContext::get_var_number(const MonomialKey& key) const {
-    auto it = monomial_to_var.find(key);
-    if (it != monomial_to_var.end()) {
-        return it->second;
+int StreamingContext::get_var_number(const MonomialKey& key) {
+    int var_num = (shared != nullptr ? shared : this)->monomial_to_var.find(key);
+    if (var_num < 0 && monomial_budget > 0) var_num = resolve_monomial(monomial_to_var, key);
+    if (var_num >= 0) {
+        return var_num;
+    }
+    std::cerr << "ERROR: Monomial not found in map during pass 2!" << std::endl;
+    return -1;
+}
+
+int StreamingContext::register_monomial(const MultilinearKey& key) {
+    if (monomial_budget > 0) {
+        spill_monomial(multilinear_to_var, key);
+        return 0;
+    }
+    int var_num = multilinear_to_var.find_or_insert(key, mDim);
+    if (var_num == mDim) mDim++;
+    return var_num;
+}
+
+int StreamingContext::get_var_number(const MultilinearKey& key) {
+    int var_num = (shared != nullptr ? shared : this)->multilinear_to_var.find(key);
+    if (var_num < 0 && monomial_budget > 0) var_num = resolve_monomial(multilinear_to_var, key);
+    if (var_num >= 0) {
+        return var_num;
     }
     std::cerr << "ERROR: Monomial not found in map during pass 2!" << std::endl;
     return -1;
@@ -167,16 +180,353 @@ void StreamingContext::start_block(int block_size) {
     current_block_entries = 0;
 }
 
+void StreamingContext::begin_block(int block_size) {
+    finish_block();
+    if (builds_structure()) {
+        start_block(block_size);
+        if (dedup_blocks) dropped.push_back(0);
+    } else if (is_dropped(raw_blocks)) {
+        skipping = true;
+    } else {
+        nBlocks++;
+    }
+    raw_blocks++;
+    block_open = true;
+    open_size = block_size;
+}
+
+bool StreamingContext::is_dropped(int raw_block) const {
+    const std::vector<char>& d = (shared != nullptr ? shared : this)->dropped;
+    return raw_block < (int)d.size() && d[raw_block] != 0;
+}
+
+void StreamingContext::finish_block() {
+    bool was_open = block_open;
+    block_open = false;
+    skipping = false;
+    if (!was_open || !dedup_blocks || !builds_structure()) {
+        flush_block_entries();
+        return;
+    }
+    canonicalize_entries(block_entries);
+    if (defer_dedup) {
+        dedup_entries.insert(dedup_entries.end(), block_entries.begin(), block_entries.end());
+        dedup_ptr.push_back((int64_t)dedup_entries.size());
+        block_entries.clear();
+        return;
+    }
+    if (!keep_block(open_size, block_entries.data(), block_entries.size())) {
+        // an identical block is already in the structure: take this one out
+        block_struct.pop_back();
+        nBlocks--;
+        current_block = nBlocks;
+        dropped.back() = 1;
+        duplicate_blocks++;
+        duplicate_entries += (int64_t)block_entries.size();
+        block_entries.clear();
+        return;
+    }
+    emit_block_entries();
+}
+
+static inline uint64_t mix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// e is the block's canonical list: sorted by (var, row, col), coalesced
+bool StreamingContext::keep_block(int block_size, const SpillRecord* e, size_t n) {
+    BlockKey key = {block_size, (int64_t)n, mix64((uint64_t)(uint32_t)block_size), mix64(~(uint64_t)(uint32_t)block_size)};
+    for (size_t t = 0; t < n; t++) {
+        uint64_t bits;
+        memcpy(&bits, &e[t].coef, sizeof(bits));
+        uint64_t words[3] = {((uint64_t)(uint32_t)e[t].var_num << 32) | (uint32_t)e[t].row, (uint64_t)(uint32_t)e[t].col, bits};
+        for (uint64_t w : words) {
+            key.h1 = mix64(key.h1 ^ w);
+            key.h2 = mix64(key.h2 + w * 0xff51afd7ed558ccdULL);
+        }
+    }
+    if (block_store == nullptr) {
+        block_store = tmpfile();
+        if (block_store == nullptr) {
+            std::cerr << "Error: Could not open a temporary file for duplicate block elimination" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    auto range = seen_blocks.equal_range(key);
+    if (range.first != range.second) {
+        // confirm the match on the stored entries, so a collision cannot drop a block
+        fflush(block_store);
+        std::vector<SpillRecord> kept(n);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (n > 0 && pread(fileno(block_store), kept.data(), n * sizeof(SpillRecord), (off_t)it->second) != (ssize_t)(n * sizeof(SpillRecord))) {
+                std::cerr << "Error: Could not read back a kept block" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            bool same = true;
+            for (size_t t = 0; t < n && same; t++) {
+                same = kept[t].var_num == e[t].var_num && kept[t].row == e[t].row && kept[t].col == e[t].col
+                    && memcmp(&kept[t].coef, &e[t].coef, sizeof(double)) == 0;
+            }
+            if (same) return false;
+        }
+    }
+    if (fseeko(block_store, 0, SEEK_END) != 0) {
+        std::cerr << "Error: Could not seek the duplicate block store" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    int64_t offset = (int64_t)ftello(block_store);
+    for (size_t t = 0; t < n; t++) {
+        SpillRecord r = e[t];
+        r.block = 0;
+        if (fwrite(&r, sizeof(r), 1, block_store) != 1) {
+            std::cerr << "Error: Could not write the duplicate block store" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    seen_blocks.emplace(key, offset);
+    return true;
+}
+
+int StreamingContext::begin_diag(int rows) {
+    if (!pack_lp) {
+        begin_block(-rows);
+        return 0;
+    }
+    spill_rows(lp_entries, lp_store, false);
+    int offset = lp_rows;
+    lp_rows += rows;
+    return offset;
+}
+
+void StreamingContext::write_diag(int var_num, int row, double coef) {
+    if (!pack_lp) {
+        write_entry(var_num, nBlocks, row, row, coef);
+        return;
+    }
+    if (is_counting_pass || coef == 0.0) return;
+    lp_entries.push_back(SpillRecord{var_num, 0, row, row, coef});
+}
+
+int StreamingContext::begin_eq(int rows) {
+    spill_rows(eq_entries, eq_store, false);
+    int offset = eq_rows;
+    eq_rows += rows;
+    return offset;
+}
+
+void StreamingContext::write_eq(int var_num, int row, double coef) {
+    if (is_counting_pass || coef == 0.0) return;
+    eq_entries.push_back(SpillRecord{var_num, 0, row, row, coef});
+}
+
+void StreamingContext::close_lp_block() {
+    finish_block();
+    if (pack_lp && lp_rows > 0) start_block(-lp_rows);
+}
+
+void StreamingContext::flush_lp_block() {
+    finish_block();
+    spill_rows(lp_entries, lp_store, true);
+    std::vector<SpillRecord>().swap(lp_entries);
+    if (lp_store == nullptr) return;
+    int lp_block = (int)block_struct.size();
+    rewind(lp_store);
+    std::vector<SpillRecord> buf(4096);
+    size_t n;
+    while ((n = fread(buf.data(), sizeof(SpillRecord), buf.size(), lp_store)) > 0) {
+        if (is_counting_pass) continue;
+        for (size_t t = 0; t < n; t++) emit_entry(buf[t].var_num, lp_block, buf[t].row, buf[t].col, buf[t].coef);
+    }
+    fclose(lp_store);
+    lp_store = nullptr;
+}
+
+void StreamingContext::spill_rows(std::vector<SpillRecord>& e, FILE*& store, bool force) {
+    if (e.empty() || (!force && e.size() < ROW_CHUNK)) return;
+    if (coalesce || dedup_blocks) canonicalize_entries(e);
+    if (store == nullptr) {
+        store = tmpfile();
+        if (store == nullptr) {
+            std::cerr << "Error: Could not open a temporary file for the linear rows" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (fwrite(e.data(), sizeof(SpillRecord), e.size(), store) != e.size()) {
+        std::cerr << "Error: Could not write the linear rows" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    e.clear();
+}
+
 void StreamingContext::write_entry(int var_num, int block, int row, int col, double coef) {
-    if (is_counting_pass || output_file == nullptr) return;
+    if (!collects_entries() || skipping) return;
     if (coef == 0.0) return;
+
+    if (coalesce || dedup_blocks) {
+        block_entries.push_back(SpillRecord{var_num, block, row, col, coef});
+        return;
+    }
+    emit_entry(var_num, block, row, col, coef);
+}
+
+static bool entry_less(const SpillRecord& a, const SpillRecord& b) {
+    if (a.block != b.block) return a.block < b.block;
+    if (a.var_num != b.var_num) return a.var_num < b.var_num;
+    if (a.row != b.row) return a.row < b.row;
+    return a.col < b.col;
+}
+
+void StreamingContext::flush_block_entries() {
+    if (block_entries.empty()) return;
+    canonicalize_entries(block_entries);
+    emit_block_entries();
+}
+
+void StreamingContext::canonicalize_entries(std::vector<SpillRecord>& e) {
+    // stable: duplicates are summed in emission order, whatever the numbering,
+    // so a parallel worker's local numbers give the serial writer's bits
+    std::stable_sort(e.begin(), e.end(), entry_less);
+    size_t kept = 0;
+    for (size_t t = 0; t < e.size(); ) {
+        SpillRecord r = e[t++];
+        while (t < e.size() && e[t].block == r.block && e[t].var_num == r.var_num && e[t].row == r.row && e[t].col == r.col) {
+            r.coef += e[t++].coef;
+        }
+        if (fabs(r.coef) < drop_tol) continue;
+        e[kept++] = r;
+    }
+    if (!is_counting_pass) coalesced_entries += (int64_t)(e.size() - kept);
+    e.resize(kept);
+}
+
+void StreamingContext::emit_block_entries() {
+    if (!is_counting_pass) {
+        for (const SpillRecord& r : block_entries) emit_entry(r.var_num, r.block, r.row, r.col, r.coef);
+    }
+    block_entries.clear();
+}
+
+void StreamingContext::emit_entry(int var_num, int block, int row, int col, double coef) {
+    if (binary) {
+        if (block >= (int)block_nnz.size()) block_nnz.resize(block + 1, 0);
+        block_nnz[block]++;
+    }
+    if (text_out != nullptr) {
+        if (binary) {
+            SpillRecord e = {var_num, block, row, col, coef};
+            text_out->append((const char*)&e, sizeof(e));
+        } else {
+            char buf[SdpaWriter::ENTRY_MAX];
+            text_out->append(buf, SdpaWriter::format_entry(buf, var_num, block, row, col, coef));
+        }
+        total_entries++;
+        return;
+    }
+    if (single_pass) {
+        if (spill_file == nullptr) return;
+        spill_buffer.push_back(SpillRecord{var_num, block, row, col, coef});
+        if (spill_buffer.size() >= 4096) flush_spill();
+        total_entries++;
+        return;
+    }
+    if (output_file == nullptr) return;
     
     // SDPA sparse format: var_num block row col value
-    fprintf(output_file, "%d %d %d %d %15.10f\n", var_num, block, row, col, coef);
+    if (binary) {
+        SpillRecord e = {var_num, block, row, col, coef};
+        out().put((const char*)&e, sizeof(e));
+    } else {
+        out().put_entry(var_num, block, row, col, coef);
+    }
     total_entries++;
 }
 
+SdpaWriter& StreamingContext::out() {
+    if (!writer.attached() && output_file != nullptr) writer.attach(output_file);
+    return writer;
+}
+
+void StreamingContext::flush_spill() {
+    if (spill_file == nullptr || spill_buffer.empty()) return;
+    if (fwrite(spill_buffer.data(), sizeof(SpillRecord), spill_buffer.size(), spill_file) != spill_buffer.size()) {
+        std::cerr << "Error: Could not write the entry spill file" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    spill_buffer.clear();
+}
+
+void StreamingContext::copy_spill() {
+    if (spill_file == nullptr || output_file == nullptr) return;
+    flush_spill();
+    rewind(spill_file);
+    std::vector<SpillRecord> buf(4096);
+    size_t n;
+    SdpaWriter& w = out();
+    while ((n = fread(buf.data(), sizeof(SpillRecord), buf.size(), spill_file)) > 0) {
+        if (binary) {
+            // the spill records are already in the container's entry layout
+            w.put((const char*)buf.data(), n * sizeof(SpillRecord));
+            continue;
+        }
+        for (size_t t = 0; t < n; t++) {
+            const SpillRecord& e = buf[t];
+            w.put_entry(e.var_num, e.block, e.row, e.col, e.coef);
+        }
+    }
+}
+
+int StreamingContext::absorb(const StreamingContext& local) {
+    std::vector<int> var_map(1, 0);   // local variable number -> this context's
+    local.monomial_to_var.for_each_key([this, &var_map](const int* p, int n) {
+        var_map.push_back(register_monomial(MonomialKey::from_packed(p, n)));
+    });
+    local.multilinear_to_var.for_each_key([this, &var_map](const int* p, int n) {
+        var_map.push_back(register_monomial(MultilinearKey::from_packed(p, n)));
+    });
+    int kept = 0;
+    for (size_t b = 0; b < local.block_struct.size(); b++) {
+        int size = local.block_struct[b];
+        if (dedup_blocks) {
+            // renumber the worker's canonical list, then compare as a serial sweep would
+            std::vector<SpillRecord> e(local.dedup_entries.begin() + local.dedup_ptr[b],
+                                       local.dedup_entries.begin() + local.dedup_ptr[b + 1]);
+            for (SpillRecord& r : e) r.var_num = var_map[r.var_num];
+            std::sort(e.begin(), e.end(), entry_less);
+            bool keep = keep_block(size, e.data(), e.size());
+            dropped.push_back(keep ? 0 : 1);
+            if (!keep) {
+                duplicate_blocks++;
+                duplicate_entries += (int64_t)e.size();
+                continue;
+            }
+        }
+        start_block(size);
+        kept++;
+    }
+    lp_rows += local.lp_rows;
+    eq_rows += local.eq_rows;
+    return kept;
+}
+
 void StreamingContext::finalize_counting() {
+    if (monomial_budget > 0) {
+        // number the spilled monomials; the maps become pass 2's lookup caches
+        monomial_index.spill(monomial_to_var);
+        monomial_index.spill(multilinear_to_var);
+        monomial_to_var.clear();
+        multilinear_to_var.clear();
+        mDim = monomial_index.merge(monomial_budget) + 1;
+        std::cout << "Out-of-core numbering: " << mDim - 1 << " monomials from " << monomial_index.runs()
+                  << " runs, index " << metrics::human_bytes((size_t)monomial_index.index_bytes()) << std::endl;
+    }
+    close_lp_block();
+    lp_rows = 0;   // the writing pass reserves the same rows again
+    eq_rows = 0;
+    raw_blocks = 0;
+
     // Prepare objective coefficient vector
     obj_coef.resize(mDim + 1, 0.0);
     is_counting_pass = false;
@@ -187,64 +537,1205 @@ void StreamingContext::finalize_counting() {
 
 void StreamingContext::write_header(const std::string& filename) {
     if (output_file == nullptr) return;
+    if (binary) {
+        write_sdpb_header();
+        return;
+    }
 
     int numBlocks = (int)block_struct.size();
+    SdpaWriter& w = out();
     
-    fprintf(output_file, "* SDPA sparse format data\n");
-    fprintf(output_file, "* File name = %s\n", filename.c_str());
-    fprintf(output_file, "* mDim = %3d, nBlock = %2d\n", mDim-1, numBlocks);
-    fprintf(output_file, "* size of bVect = 1 * %3d\n", mDim-1);    
+    char line[256];
+    w.put("* SDPA sparse format data\n");
+    w.put("* File name = " + filename + "\n");
+    w.put(line, snprintf(line, sizeof(line), "* mDim = %3d, nBlock = %2d\n", mDim-1, numBlocks));
+    w.put(line, snprintf(line, sizeof(line), "* size of bVect = 1 * %3d\n", mDim-1));
     // Number of variables
-    fprintf(output_file, "%d\n", mDim-1);
+    w.put_int(mDim-1);
+    w.put("\n");
     
     // Number of blocks
-    fprintf(output_file, "%d\n", numBlocks);
+    w.put_int(numBlocks);
+    w.put("\n");
     
     // Block structure
     for (int i = 0; i < numBlocks; i++) {
-        fprintf(output_file, "%d ", block_struct[i]);
+        w.put_int(block_struct[i]);
+        w.put(" ");
+    }
+    w.put("\n");
+    
+    // Objective coefficients (will be filled by convert_obj_stream in pass 2)
+    for (int i = 0; i < mDim-1; i++) {
+        // DEBUG
+        if (i < 5) { 
+            std::cout << "[-DEBUG WRITE-] obj_coef[" << i << "] = " << obj_coef[i] << std::endl;
+        }
+        // END DEBUG
+        w.put_sci(obj_coef[i]);
+    }
+    w.put("\n");
+}
+
+void StreamingContext::write_sdpb_header() {
+    const uint16_t probe = 1;
+    if (*(const unsigned char*)&probe != 1) {
+        std::cerr << "Error: the .sdpb container is only written on little-endian hosts" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    int numBlocks = (int)block_struct.size();
+    memcpy(sdpb.magic, SDPB_MAGIC, sizeof(sdpb.magic));
+    sdpb.version = SDPB_VERSION;
+    sdpb.header_bytes = sizeof(SdpbHeader);
+    sdpb.mDim = mDim - 1;
+    sdpb.nBlocks = numBlocks;
+    sdpb.nnz = 0;          // completed by finalize_file
+    sdpb.ptr_offset = 0;
+    sdpb.blocks_offset = sizeof(SdpbHeader);
+    sdpb.obj_offset = sdpb.blocks_offset + (4 * (int64_t)numBlocks + 7) / 8 * 8;
+    sdpb.entries_offset = sdpb.obj_offset + 8 * (int64_t)sdpb.mDim;
+
+    SdpaWriter& w = out();
+    w.put((const char*)&sdpb, sizeof(sdpb));
+    w.put((const char*)block_struct.data(), 4 * (size_t)numBlocks);
+    if (numBlocks % 2 == 1) w.put("\0\0\0\0", 4);
+    w.put((const char*)obj_coef.data(), 8 * (size_t)sdpb.mDim);
+}
+
+void StreamingContext::finalize_file() {
+    finish_block();
+    if (block_store != nullptr) {
+        fclose(block_store);
+        block_store = nullptr;
+        seen_blocks.clear();
+    }
+    if (binary && output_file != nullptr && sdpb.header_bytes != 0) {
+        // block pointers go after the entries; then the header is completed in place
+        std::vector<int64_t> ptr(sdpb.nBlocks + 1, 0);
+        for (int b = 1; b <= sdpb.nBlocks; b++) {
+            ptr[b] = ptr[b - 1] + (b < (int)block_nnz.size() ? block_nnz[b] : 0);
+        }
+        sdpb.nnz = ptr[sdpb.nBlocks];
+        sdpb.ptr_offset = sdpb.entries_offset + (int64_t)sizeof(SpillRecord) * sdpb.nnz;
+        out().put((const char*)ptr.data(), ptr.size() * sizeof(int64_t));
+        writer.detach();
+        if (fseek(output_file, 0, SEEK_SET) != 0 || fwrite(&sdpb, sizeof(sdpb), 1, output_file) != 1) {
+            std::cerr << "Error: Could not complete the .sdpb header" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    writer.detach();
+    if (output_file != nullptr) {
+        fclose(output_file);
+        output_file = nullptr;
+    }
+}
+
+char* SdpaWriter::format_entry(char* p, int var_num, int block, int row, int col, double coef) {
+    p = std::to_chars(p, p + 12, var_num).ptr;
+    *p++ = ' ';
+    p = std::to_chars(p, p + 12, block).ptr;
+    *p++ = ' ';
+    p = std::to_chars(p, p + 12, row).ptr;
+    *p++ = ' ';
+    p = std::to_chars(p, p + 12, col).ptr;
+    *p++ = ' ';
+    // %15.10f: right-aligned in 15 columns
+    char num[SdpaWriter::ENTRY_MAX - 64];
+    char* end = std::to_chars(num, num + sizeof(num), coef, std::chars_format::fixed, 10).ptr;
+    size_t len = end - num;
+    for (size_t k = len; k < 15; k++) *p++ = ' ';
+    memcpy(p, num, len);
+    p += len;
+    *p++ = '\n';
+    return p;
+}
+
+void SdpaWriter::put_entry(int var_num, int block, int row, int col, double coef) {
+    char* p = reserve(ENTRY_MAX);
+    used = format_entry(p, var_num, block, row, col, coef) - front.data();
+}
+
+void SdpaWriter::put_sci(double value) {
+    char* p = reserve(ENTRY_MAX);
+    p = std::to_chars(p, p + ENTRY_MAX - 1, value, std::chars_format::scientific, 15).ptr;
+    *p++ = ' ';
+    used = p - front.data();
+}
+
+void SdpaWriter::put_int(int value) {
+    char* p = reserve(16);
+    used = std::to_chars(p, p + 16, value).ptr - front.data();
+}
+
+void SdpaWriter::put_int64(int64_t value) {
+    char* p = reserve(24);
+    used = std::to_chars(p, p + 24, value).ptr - front.data();
+}
+
+void SdpaWriter::put_double(double value) {
+    char* p = reserve(32);
+    used = std::to_chars(p, p + 32, value).ptr - front.data();
+}
+
+void SdpaWriter::put(const char* text, size_t n) {
+    while (n > 0) {
+        size_t room = front.size() - used;
+        if (room == 0) {
+            hand_off();
+            continue;
+        }
+        size_t k = std::min(n, room);
+        memcpy(front.data() + used, text, k);
+        used += k;
+        text += k;
+        n -= k;
+    }
+}
+
+void SdpaWriter::attach(FILE* f) {
+    detach();
+    file = f;
+    front.resize(capacity);
+    back.resize(capacity);
+    used = 0;
+    pending = 0;
+    stop = false;
+    thread = std::thread(&SdpaWriter::run, this);
+}
+
+// Wait for the writer to finish the back buffer, then swap and hand it the front
+void SdpaWriter::hand_off() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this] { return pending == 0; });
+    if (used == 0) return;
+    std::swap(front, back);
+    pending = used;
+    used = 0;
+    cv.notify_all();
+}
+
+void SdpaWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cv.wait(lock, [this] { return pending > 0 || stop; });
+        if (pending == 0) break;
+        size_t n = pending;
+        lock.unlock();
+        if (fwrite(back.data(), 1, n, file) != n) failed = true;
+        lock.lock();
+        pending = 0;
+        cv.notify_all();
+    }
+}
+
+void SdpaWriter::detach() {
+    if (file == nullptr) return;
+    hand_off();
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return pending == 0; });
+        stop = true;
+        cv.notify_all();
+    }
+    thread.join();
+    fflush(file);
+    file = nullptr;
+    std::vector<char>().swap(front);
+    std::vector<char>().swap(back);
+    if (failed) {
+        std::cerr << "Error: Could not write the SDPA file" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+// (hash, size, ints) order of the runs and of the index records
+static bool key_order(uint64_t ha, const int* a, int na, uint64_t hb, const int* b, int nb) {
+    if (ha != hb) return ha < hb;
+    if (na != nb) return na < nb;
+    return std::lexicographical_compare(a, a + na, b, b + nb);
+}
+
+uint64_t OutOfCoreIndex::key_hash(const int* p, int n) {
+    uint64_t h = mix64((uint64_t)(uint32_t)n);
+    for (int i = 0; i < n; i++) h = mix64(h ^ (uint32_t)p[i]);
+    return h;
+}
+
+bool OutOfCoreIndex::open(const std::string& prefix) {
+    close();
+    run_path = prefix + ".runs";
+    index_path = prefix + ".index";
+    run_file = fopen(run_path.c_str(), "w+b");
+    index_file = fopen(index_path.c_str(), "w+b");
+    if (run_file == nullptr || index_file == nullptr) {
+        std::cerr << "Warning: Could not open " << run_path << " and " << index_path << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void OutOfCoreIndex::close() {
+    if (run_file != nullptr) {
+        fclose(run_file);
+        remove(run_path.c_str());
+        run_file = nullptr;
+    }
+    if (index_file != nullptr) {
+        fclose(index_file);
+        remove(index_path.c_str());
+        index_file = nullptr;
+    }
+    std::vector<RunKey>().swap(run_keys);
+    spilled = 0;
+    max_record = 0;
+    run_begin.assign(1, 0);
+    page_first.clear();
+    std::vector<char>().swap(page);
+    page_loaded = -1;
+}
+
+// Run records: uint64 hash, int64 ordinal, int32 n, int32 key[n]
+void OutOfCoreIndex::write_run() {
+    if (run_keys.empty()) return;
+    std::sort(run_keys.begin(), run_keys.end(), [](const RunKey& a, const RunKey& b) {
+        return key_order(a.hash, a.p, a.n, b.hash, b.p, b.n);
+    });
+    std::vector<char> buf;
+    buf.reserve(PAGE);
+    int64_t bytes = 0;
+    bool ok = true;
+    for (const RunKey& k : run_keys) {
+        if (24 + 4 * (size_t)k.n > PAGE) {
+            std::cerr << "Error: monomial of " << k.n << " ints is too long for the out-of-core index" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        int32_t n = k.n;
+        max_record = std::max(max_record, 20 + 4 * (size_t)k.n);
+        buf.insert(buf.end(), (const char*)&k.hash, (const char*)&k.hash + 8);
+        buf.insert(buf.end(), (const char*)&k.ord, (const char*)&k.ord + 8);
+        buf.insert(buf.end(), (const char*)&n, (const char*)&n + 4);
+        buf.insert(buf.end(), (const char*)k.p, (const char*)(k.p + k.n));
+        if (buf.size() >= PAGE) {
+            ok = ok && fwrite(buf.data(), 1, buf.size(), run_file) == buf.size();
+            bytes += (int64_t)buf.size();
+            buf.clear();
+        }
+    }
+    ok = ok && fwrite(buf.data(), 1, buf.size(), run_file) == buf.size();
+    bytes += (int64_t)buf.size();
+    if (!ok) {
+        std::cerr << "Error: Could not write the monomial runs to " << run_path << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    run_begin.push_back(run_begin.back() + bytes);
+    std::vector<RunKey>().swap(run_keys);
+}
+
+namespace {
+// Sequential reader of one run of the runs file
+struct RunReader {
+    int fd;
+    int64_t pos, end;
+    std::vector<char> buf;
+    size_t at = 0, len = 0;
+    uint64_t hash = 0;
+    int64_t ord = 0;
+    std::vector<int> key;
+
+    // at least need unread bytes in buf, unless the run ends first
+    bool fill(size_t need) {
+        if (len - at >= need) return true;
+        memmove(buf.data(), buf.data() + at, len - at);
+        len -= at;
+        at = 0;
+        size_t want = (size_t)std::min<int64_t>((int64_t)(buf.size() - len), end - pos);
+        if (want > 0) {
+            ssize_t got = pread(fd, buf.data() + len, want, (off_t)pos);
+            if (got != (ssize_t)want) {
+                std::cerr << "Error: Could not read the monomial runs" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            len += want;
+            pos += (int64_t)want;
+        }
+        return len - at >= need;
+    }
+    // read the next record into hash/key; false at the end of the run
+    bool next() {
+        if (!fill(20)) return false;
+        int32_t n;
+        memcpy(&hash, buf.data() + at, 8);
+        memcpy(&ord, buf.data() + at + 8, 8);
+        memcpy(&n, buf.data() + at + 16, 4);
+        at += 20;
+        fill(4 * (size_t)n);
+        key.resize(n);
+        memcpy(key.data(), buf.data() + at, 4 * (size_t)n);
+        at += 4 * (size_t)n;
+        return true;
+    }
+};
+}
+
+// Index pages: records {uint64 hash, int64 ordinal, int32 n, int32 var,
+// int32 key[n]}, never split across pages; a record with n = -1 (or fewer than
+// 24 bytes) ends a page
+template <class F>
+void OutOfCoreIndex::for_each_record(char* p, F f) {
+    for (size_t at = 0; at + 24 <= PAGE; ) {
+        int32_t n;
+        memcpy(&n, p + at + 16, 4);
+        if (n < 0) break;
+        f(p + at);
+        at += 24 + 4 * (size_t)n;
+    }
+}
+
+int OutOfCoreIndex::merge(size_t budget) {
+    fflush(run_file);
+    int nruns = runs();
+    size_t bufsize = std::max(std::max(max_record, (size_t)4096), budget / std::max(1, nruns));
+    std::vector<RunReader> readers(nruns);
+    auto later = [&readers](int a, int b) {
+        const RunReader& x = readers[a];
+        const RunReader& y = readers[b];
+        return key_order(y.hash, y.key.data(), (int)y.key.size(), x.hash, x.key.data(), (int)x.key.size());
+    };
+    std::vector<int> heap;
+    for (int r = 0; r < nruns; r++) {
+        readers[r].fd = fileno(run_file);
+        readers[r].pos = run_begin[r];
+        readers[r].end = run_begin[r + 1];
+        readers[r].buf.resize(bufsize);
+        if (readers[r].next()) heap.push_back(r);
+    }
+    std::make_heap(heap.begin(), heap.end(), later);
+
+    page.assign(PAGE, 0);
+    size_t used = 0;
+    auto write_page = [this, &used]() {
+        if (PAGE - used >= 24) {
+            int32_t end = -1;
+            memcpy(page.data() + used + 16, &end, 4);
+        }
+        if (fwrite(page.data(), 1, PAGE, index_file) != PAGE) {
+            std::cerr << "Error: Could not write the monomial index to " << index_path << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        memset(page.data(), 0, PAGE);
+        used = 0;
+    };
+    int count = 0;
+    uint64_t last_hash = 0;
+    int64_t last_ord = 0;
+    size_t last_at = 0;
+    std::vector<int> last;
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        RunReader& r = readers[heap.back()];
+        if (count > 0 && r.hash == last_hash && r.key == last) {
+            // spilled more than once: the first insertion counts (the record
+            // is still in the page being filled)
+            if (r.ord < last_ord) {
+                last_ord = r.ord;
+                memcpy(page.data() + last_at + 8, &last_ord, 8);
+            }
+        } else {
+            count++;
+            int32_t n = (int32_t)r.key.size();
+            int32_t var = 0;   // set by number_by_ordinal
+            size_t rec = 24 + 4 * (size_t)n;
+            if (used + rec > PAGE) write_page();
+            if (used == 0) page_first.push_back(r.hash);
+            memcpy(page.data() + used, &r.hash, 8);
+            memcpy(page.data() + used + 8, &r.ord, 8);
+            memcpy(page.data() + used + 16, &n, 4);
+            memcpy(page.data() + used + 20, &var, 4);
+            memcpy(page.data() + used + 24, r.key.data(), 4 * (size_t)n);
+            last_at = used;
+            used += rec;
+            last_hash = r.hash;
+            last_ord = r.ord;
+            last = r.key;
+        }
+        if (r.next()) {
+            std::push_heap(heap.begin(), heap.end(), later);
+        } else {
+            heap.pop_back();
+        }
+    }
+    if (used > 0) write_page();
+    fflush(index_file);
+
+    // the runs are no longer needed
+    readers.clear();
+    fclose(run_file);
+    remove(run_path.c_str());
+    run_file = nullptr;
+    number_by_ordinal();
+    page_loaded = -1;
+    return count;
+}
+
+// The ordinals of the distinct keys are marked in a bitmap; a key's number is
+// one plus the count of marked ordinals below its own
+void OutOfCoreIndex::number_by_ordinal() {
+    int fd = fileno(index_file);
+    page.resize(PAGE);
+    auto read_page = [this, fd](size_t pg) {
+        if (pread(fd, page.data(), PAGE, (off_t)(pg * PAGE)) != (ssize_t)PAGE) {
+            std::cerr << "Error: Could not read the monomial index" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    };
+    std::vector<uint64_t> marked((size_t)(spilled + 63) / 64, 0);
+    for (size_t pg = 0; pg < page_first.size(); pg++) {
+        read_page(pg);
+        for_each_record(page.data(), [&marked](char* rec) {
+            int64_t ord;
+            memcpy(&ord, rec + 8, 8);
+            marked[ord / 64] |= (uint64_t)1 << (ord % 64);
+        });
+    }
+    std::vector<int> below(marked.size(), 0);   // marked ordinals in earlier words
+    for (size_t w = 1; w < marked.size(); w++) {
+        below[w] = below[w - 1] + (int)std::bitset<64>(marked[w - 1]).count();
+    }
+    for (size_t pg = 0; pg < page_first.size(); pg++) {
+        read_page(pg);
+        for_each_record(page.data(), [&marked, &below](char* rec) {
+            int64_t ord;
+            memcpy(&ord, rec + 8, 8);
+            uint64_t lower = marked[ord / 64] & (((uint64_t)1 << (ord % 64)) - 1);
+            int32_t var = below[ord / 64] + (int)std::bitset<64>(lower).count() + 1;
+            memcpy(rec + 20, &var, 4);
+        });
+        if (pwrite(fd, page.data(), PAGE, (off_t)(pg * PAGE)) != (ssize_t)PAGE) {
+            std::cerr << "Error: Could not write the monomial index to " << index_path << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+int OutOfCoreIndex::find(const int* p, int n) {
+    if (page_first.empty()) return -1;
+    uint64_t h = key_hash(p, n);
+    // records of hash h start at the last page whose first hash is below h
+    size_t lo = std::lower_bound(page_first.begin(), page_first.end(), h) - page_first.begin();
+    size_t hi = std::upper_bound(page_first.begin(), page_first.end(), h) - page_first.begin();
+    if (lo > 0) lo--;
+    for (size_t pg = lo; pg < hi; pg++) {
+        if ((int64_t)pg != page_loaded) {
+            page.resize(PAGE);
+            if (pread(fileno(index_file), page.data(), PAGE, (off_t)(pg * PAGE)) != (ssize_t)PAGE) {
+                std::cerr << "Error: Could not read the monomial index" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            page_loaded = (int64_t)pg;
+        }
+        for (size_t at = 0; at + 24 <= PAGE; ) {
+            uint64_t rh;
+            int32_t rn, var;
+            memcpy(&rh, page.data() + at, 8);
+            memcpy(&rn, page.data() + at + 16, 4);
+            if (rn < 0 || rh > h) break;
+            memcpy(&var, page.data() + at + 20, 4);
+            if (rh == h && rn == n && memcmp(page.data() + at + 24, p, 4 * (size_t)n) == 0) return var;
+            at += 24 + 4 * (size_t)rn;
+        }
+    }
+    return -1;
+}
+
+// true when [offset, offset + bytes) lies in a file of length bytes, after the header
+static bool section_fits(int64_t offset, int64_t bytes, size_t length) {
+    return offset >= (int64_t)sizeof(SdpbHeader) && bytes >= 0
+        && offset <= (int64_t)length && bytes <= (int64_t)length - offset;
+}
+
+bool SdpbView::open(const std::string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error: Could not open " << path << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(SdpbHeader)) {
+        std::cerr << "Error: " << path << " is too short for an .sdpb header" << std::endl;
+        ::close(fd);
+        return false;
+    }
+    void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        std::cerr << "Error: Could not map " << path << std::endl;
+        return false;
+    }
+    base = (const char*)p;
+    length = (size_t)st.st_size;
+
+    const SdpbHeader& h = header();
+    const char* problem = nullptr;
+    if (memcmp(h.magic, SDPB_MAGIC, sizeof(h.magic)) != 0) {
+        problem = "not an .sdpb file";
+    } else if (h.version != SDPB_VERSION) {
+        problem = "unsupported container version";
+    } else if (h.header_bytes != sizeof(SdpbHeader)) {
+        problem = "unexpected header size";
+    } else if (h.mDim < 0 || h.nBlocks < 0 || h.nnz < 0 || h.nnz > (int64_t)(length / sizeof(SpillRecord))) {
+        problem = "invalid mDim, nBlocks or nnz";
+    } else if (h.blocks_offset % 8 != 0 || h.obj_offset % 8 != 0 || h.entries_offset % 8 != 0 || h.ptr_offset % 8 != 0) {
+        problem = "misaligned section";
+    } else if (!section_fits(h.blocks_offset, 4 * (int64_t)h.nBlocks, length)
+            || !section_fits(h.obj_offset, 8 * (int64_t)h.mDim, length)
+            || !section_fits(h.entries_offset, (int64_t)sizeof(SpillRecord) * h.nnz, length)
+            || !section_fits(h.ptr_offset, 8 * ((int64_t)h.nBlocks + 1), length)) {
+        problem = "section outside the file";
+    } else if (h.blocks_offset + 4 * (int64_t)h.nBlocks > h.obj_offset
+            || h.obj_offset + 8 * (int64_t)h.mDim > h.entries_offset
+            || h.entries_offset + (int64_t)sizeof(SpillRecord) * h.nnz > h.ptr_offset) {
+        problem = "overlapping sections";
+    }
+    if (problem != nullptr) {
+        std::cerr << "Error: " << path << ": " << problem << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SdpbView::close() {
+    if (base != nullptr) munmap((void*)base, length);
+    base = nullptr;
+    length = 0;
+}
+
+bool SdpbView::validate() const {
+    if (base == nullptr) return false;
+    const SdpbHeader& h = header();
+    const int32_t* bs = block_struct();
+    const int64_t* ptr = block_ptr();
+    const SpillRecord* e = entries();
+
+    if (ptr[0] != 0 || ptr[h.nBlocks] != h.nnz) {
+        std::cerr << "Error: block pointers do not cover the " << h.nnz << " entries" << std::endl;
+        return false;
+    }
+    for (int i = 0; i < h.mDim; i++) {
+        if (!std::isfinite(obj()[i])) {
+            std::cerr << "Error: objective coefficient " << i + 1 << " is not finite" << std::endl;
+            return false;
+        }
+    }
+    for (int b = 1; b <= h.nBlocks; b++) {
+        int size = bs[b - 1];
+        if (size == 0 || ptr[b] < ptr[b - 1]) {
+            std::cerr << "Error: block " << b << " has size 0 or a negative entry count" << std::endl;
+            return false;
+        }
+        int n = std::abs(size);
+        for (int64_t t = ptr[b - 1]; t < ptr[b]; t++) {
+            const SpillRecord& r = e[t];
+            const char* problem = nullptr;
+            if (r.block != b) {
+                problem = "block number differs from its section";
+            } else if (r.var_num < 0 || r.var_num > h.mDim) {
+                problem = "variable out of range";
+            } else if (r.row < 1 || r.row > n || r.col < 1 || r.col > n) {
+                problem = "row/col outside the block";
+            } else if (size < 0 && r.row != r.col) {
+                problem = "off-diagonal entry in a diagonal block";
+            } else if (!std::isfinite(r.coef)) {
+                problem = "coefficient is not finite";
+            }
+            if (problem != nullptr) {
+                std::cerr << "Error: entry " << t << " (" << r.var_num << " " << r.block << " " << r.row << " " << r.col << "): " << problem << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool check_sdpb_file(const std::string& path) {
+    SdpbView view;
+    if (!view.open(path) || !view.validate()) return false;
+    const SdpbHeader& h = view.header();
+    int largest = 0, lp_rows = 0;
+    for (int b = 0; b < h.nBlocks; b++) {
+        int size = view.block_struct()[b];
+        if (size < 0) lp_rows -= size;
+        else largest = std::max(largest, size);
+    }
+    std::cout << path << ": valid .sdpb v" << h.version << ", mDim = " << h.mDim << ", nBlocks = " << h.nBlocks
+              << ", nnz = " << h.nnz << ", largest PSD block = " << largest << ", LP rows = " << lp_rows << std::endl;
+    return true;
+}
+
+// CBF (Conic Benchmark Format, version 3) output. The SDPA problem
+//   min c^T y  s.t.  sum_i F_i y_i - F_0 >= 0  (PSD blocks and LP rows)
+// becomes scalar variables y_1..y_m, PSD constraints sum_i H_i y_i + D with
+// D = -F_0, L+ rows for the LP block and L= rows for the equalities (which the
+// SDPA file carries as +/- row pairs). Coordinates are 0-based, PSD entries
+// are lower triangular and duplicate coordinates are summed.
+
+// Sort entries by (row, col, var) and sum duplicates; zero sums are dropped
+static void coalesce_entries(std::vector<SpillRecord>& e) {
+    std::sort(e.begin(), e.end(), [](const SpillRecord& a, const SpillRecord& b) {
+        if (a.row != b.row) return a.row < b.row;
+        if (a.col != b.col) return a.col < b.col;
+        return a.var_num < b.var_num;
+    });
+    size_t n = 0;
+    for (size_t t = 0; t < e.size(); t++) {
+        if (n > 0 && e[n - 1].row == e[t].row && e[n - 1].col == e[t].col && e[n - 1].var_num == e[t].var_num) {
+            e[n - 1].coef += e[t].coef;
+        } else {
+            e[n++] = e[t];
+        }
+    }
+    e.resize(n);
+    e.erase(std::remove_if(e.begin(), e.end(), [](const SpillRecord& r) { return r.coef == 0.0; }), e.end());
+}
+
+// Entries of block b of an .sdpb view, lower triangular (row >= col), coalesced
+static void psd_block_entries(const SdpbView& view, int b, std::vector<SpillRecord>& e) {
+    e.assign(view.entries() + view.block_ptr()[b - 1], view.entries() + view.block_ptr()[b]);
+    for (SpillRecord& r : e) {
+        if (r.row < r.col) std::swap(r.row, r.col);
+    }
+    coalesce_entries(e);
+}
+
+static bool write_cbf(const std::string& conicfile, StreamingContext& ctx, const std::string& cbffile) {
+    SdpbView view;
+    if (!view.open(conicfile)) return false;
+    const SdpbHeader& h = view.header();
+    const int32_t* bs = view.block_struct();
+
+    // linear rows: LP blocks first (L+), then the equalities (L=). Both are
+    // coalesced by the writer (rows are never shared between the two), so
+    // for_each_lin streams them as they are, from the mapped container and
+    // from eq_store, with the 0-based CBF row in row
+    int nlp = 0;
+    for (int b = 1; b <= h.nBlocks; b++) {
+        if (bs[b - 1] < 0) nlp -= bs[b - 1];
+    }
+    int neq = ctx.eq_rows;
+    ctx.spill_rows(ctx.eq_entries, ctx.eq_store, true);
+    std::vector<SpillRecord>().swap(ctx.eq_entries);
+    auto for_each_lin = [&](auto f) {
+        int base = 0;
+        for (int b = 1; b <= h.nBlocks; b++) {
+            if (bs[b - 1] > 0) continue;
+            for (int64_t t = view.block_ptr()[b - 1]; t < view.block_ptr()[b]; t++) {
+                SpillRecord r = view.entries()[t];
+                r.row = r.col = base + r.row - 1;
+                f(r);
+            }
+            base -= bs[b - 1];
+        }
+        if (ctx.eq_store == nullptr) return;
+        rewind(ctx.eq_store);
+        std::vector<SpillRecord> buf(4096);
+        size_t n;
+        while ((n = fread(buf.data(), sizeof(SpillRecord), buf.size(), ctx.eq_store)) > 0) {
+            for (size_t t = 0; t < n; t++) {
+                SpillRecord r = buf[t];
+                r.row = r.col = nlp + r.row - 1;
+                f(r);
+            }
+        }
+    };
+
+    // PSD constraints: count the H / D coordinates block by block
+    std::vector<int> psd;
+    int64_t nh = 0, nd = 0;
+    std::vector<SpillRecord> e;
+    for (int b = 1; b <= h.nBlocks; b++) {
+        if (bs[b - 1] < 0) continue;
+        psd.push_back(b);
+        psd_block_entries(view, b, e);
+        for (const SpillRecord& r : e) (r.var_num == 0 ? nd : nh)++;
+    }
+
+    FILE* fp = fopen(cbffile.c_str(), "w");
+    if (fp == nullptr) {
+        std::cerr << "Error: Could not open output file " << cbffile << std::endl;
+        return false;
+    }
+    SdpaWriter w;
+    w.attach(fp);
+    w.put("VER\n3\n\nOBJSENSE\nMIN\n\nVAR\n");
+    w.put_int(h.mDim);
+    w.put(" 1\nF ");
+    w.put_int(h.mDim);
+    w.put("\n\n");
+    if (!psd.empty()) {
+        w.put("PSDCON\n");
+        w.put_int((int)psd.size());
+        w.put("\n");
+        for (int b : psd) {
+            w.put_int(bs[b - 1]);
+            w.put("\n");
+        }
+        w.put("\n");
+    }
+    if (nlp + neq > 0) {
+        w.put("CON\n");
+        w.put_int(nlp + neq);
+        w.put(nlp > 0 && neq > 0 ? " 2\n" : " 1\n");
+        if (nlp > 0) {
+            w.put("L+ ");
+            w.put_int(nlp);
+            w.put("\n");
+        }
+        if (neq > 0) {
+            w.put("L= ");
+            w.put_int(neq);
+            w.put("\n");
+        }
+        w.put("\n");
+    }
+
+    int nobj = 0;
+    for (int i = 0; i < h.mDim; i++) nobj += view.obj()[i] != 0.0;
+    if (nobj > 0) {
+        w.put("OBJACOORD\n");
+        w.put_int(nobj);
+        w.put("\n");
+        for (int i = 0; i < h.mDim; i++) {
+            if (view.obj()[i] == 0.0) continue;
+            w.put_int(i);
+            w.put(" ");
+            w.put_double(view.obj()[i]);
+            w.put("\n");
+        }
+        w.put("\n");
+    }
+
+    int64_t na = 0, nb = 0;
+    for_each_lin([&](const SpillRecord& r) { (r.var_num != 0 ? na : nb)++; });
+    if (na > 0) {
+        w.put("ACOORD\n");
+        w.put_int64(na);
+        w.put("\n");
+        for_each_lin([&](const SpillRecord& r) {
+            if (r.var_num == 0) return;
+            w.put_int(r.row);
+            w.put(" ");
+            w.put_int(r.var_num - 1);
+            w.put(" ");
+            w.put_double(r.coef);
+            w.put("\n");
+        });
+        w.put("\n");
+    }
+    if (nb > 0) {
+        w.put("BCOORD\n");
+        w.put_int64(nb);
+        w.put("\n");
+        for_each_lin([&](const SpillRecord& r) {
+            if (r.var_num != 0) return;
+            w.put_int(r.row);
+            w.put(" ");
+            w.put_double(-r.coef);
+            w.put("\n");
+        });
+        w.put("\n");
+    }
+
+    // H and D coordinates; the blocks are coalesced again for each section
+    for (int pass = 0; pass < 2; pass++) {
+        int64_t count = pass == 0 ? nh : nd;
+        if (count == 0) continue;
+        w.put(pass == 0 ? "HCOORD\n" : "DCOORD\n");
+        w.put_int64(count);
+        w.put("\n");
+        for (size_t k = 0; k < psd.size(); k++) {
+            psd_block_entries(view, psd[k], e);
+            for (const SpillRecord& r : e) {
+                if ((r.var_num == 0) != (pass == 1)) continue;
+                w.put_int((int)k);
+                w.put(" ");
+                if (pass == 0) {
+                    w.put_int(r.var_num - 1);
+                    w.put(" ");
+                }
+                w.put_int(r.row - 1);
+                w.put(" ");
+                w.put_int(r.col - 1);
+                w.put(" ");
+                w.put_double(pass == 0 ? r.coef : -r.coef);
+                w.put("\n");
+            }
+        }
+        w.put("\n");
+    }
+    w.detach();
+    fclose(fp);
+    if (ctx.eq_store != nullptr) {
+        fclose(ctx.eq_store);
+        ctx.eq_store = nullptr;
+    }
+    std::cout << "CBF written: " << psd.size() << " PSD constraints, " << nlp << " L+ rows, "
+              << neq << " L= rows (" << na + nb + nh + nd << " coordinates)" << std::endl;
+    return true;
+}
+
+// SDPA problem in the form compared by check_cbf_equivalence: PSD blocks as
+// coalesced lower-triangular entries (var 0 = F_0), linear rows as sorted
+// (var, coef) lists with var 0 = the F_0 entry; empty rows are dropped
+struct CanonicalSdp {
+    int mDim = 0;
+    std::vector<double> obj;
+    std::vector<int> psd_size;
+    std::vector<std::vector<SpillRecord>> psd;
+    std::vector<std::vector<std::pair<int, double>>> rows;
+};
+
+// Sum duplicate variables of a linear row, drop zeros; false if the row is empty
+static bool canonical_row(std::vector<std::pair<int, double>>& row) {
+    std::sort(row.begin(), row.end());
+    size_t n = 0;
+    for (size_t t = 0; t < row.size(); t++) {
+        if (n > 0 && row[n - 1].first == row[t].first) row[n - 1].second += row[t].second;
+        else row[n++] = row[t];
+    }
+    row.resize(n);
+    row.erase(std::remove_if(row.begin(), row.end(), [](const std::pair<int, double>& p) { return p.second == 0.0; }), row.end());
+    return !row.empty();
+}
+
+// Add an SDPA problem (block structure and entries) to c
+static void canonical_from_sdpa(const std::vector<int>& bs, std::vector<SpillRecord>& entries, CanonicalSdp& c) {
+    std::vector<int> psd_index(bs.size() + 1, -1);
+    for (size_t b = 0; b < bs.size(); b++) {
+        if (bs[b] > 0) {
+            psd_index[b + 1] = (int)c.psd.size();
+            c.psd_size.push_back(bs[b]);
+            c.psd.emplace_back();
+        }
+    }
+    std::map<std::pair<int, int>, std::vector<std::pair<int, double>>> lp;
+    for (SpillRecord r : entries) {
+        if (r.block >= 1 && r.block <= (int)bs.size() && psd_index[r.block] >= 0) {
+            if (r.row < r.col) std::swap(r.row, r.col);
+            c.psd[psd_index[r.block]].push_back(r);
+        } else {
+            lp[std::make_pair(r.block, r.row)].push_back(std::make_pair(r.var_num, r.coef));
+        }
+    }
+    for (std::vector<SpillRecord>& e : c.psd) coalesce_entries(e);
+    for (auto& kv : lp) {
+        if (canonical_row(kv.second)) c.rows.push_back(kv.second);
+    }
+}
+
+// Read an SDPA text file or an .sdpb container into c
+static bool load_sdpa_canonical(const std::string& path, CanonicalSdp& c) {
+    std::vector<int> bs;
+    std::vector<SpillRecord> entries;
+    if (path.size() >= 5 && path.compare(path.size() - 5, 5, ".sdpb") == 0) {
+        SdpbView view;
+        if (!view.open(path) || !view.validate()) return false;
+        const SdpbHeader& h = view.header();
+        c.mDim = h.mDim;
+        c.obj.assign(view.obj(), view.obj() + h.mDim);
+        bs.assign(view.block_struct(), view.block_struct() + h.nBlocks);
+        entries.assign(view.entries(), view.entries() + h.nnz);
+    } else {
+        std::ifstream in(path.c_str());
+        if (!in) {
+            std::cerr << "Error: Could not open " << path << std::endl;
+            return false;
+        }
+        // drop the comment lines, then read the numbers in order
+        std::string line, text;
+        while (std::getline(in, line)) {
+            if (!line.empty() && line[0] != '*' && line[0] != '"') text += line + "\n";
+        }
+        std::istringstream ss(text);
+        int nblocks = 0;
+        ss >> c.mDim >> nblocks;
+        bs.resize(nblocks);
+        for (int& b : bs) ss >> b;
+        c.obj.resize(c.mDim);
+        for (double& v : c.obj) ss >> v;
+        SpillRecord r;
+        while (ss >> r.var_num >> r.block >> r.row >> r.col >> r.coef) entries.push_back(r);
+        if (!ss.eof() || nblocks <= 0) {
+            std::cerr << "Error: " << path << " is not an SDPA sparse file" << std::endl;
+            return false;
+        }
+    }
+    canonical_from_sdpa(bs, entries, c);
+    return true;
+}
+
+// Read a CBF file written by write_cbf into c; every L= row contributes the
+// row and its negation, as in the SDPA encoding
+static bool load_cbf_canonical(const std::string& path, CanonicalSdp& c, int& neq) {
+    std::ifstream in(path.c_str());
+    if (!in) {
+        std::cerr << "Error: Could not open " << path << std::endl;
+        return false;
+    }
+    std::vector<char> row_kind;   // '+' or '=' per linear row
+    std::map<int, std::vector<std::pair<int, double>>> rows;
+    std::string key;
+    const char* problem = nullptr;
+    while (problem == nullptr && in >> key) {
+        if (key == "VER") {
+            int ver;
+            in >> ver;
+            if (ver != 3) problem = "unsupported CBF version";
+        } else if (key == "OBJSENSE") {
+            in >> key;
+            if (key != "MIN") problem = "objective sense is not MIN";
+        } else if (key == "VAR") {
+            int k, m;
+            in >> c.mDim >> k >> key >> m;
+            if (k != 1 || key != "F" || m != c.mDim) problem = "variables are not one free cone";
+            c.obj.assign(c.mDim, 0.0);
+        } else if (key == "PSDCON") {
+            int n;
+            in >> n;
+            c.psd_size.resize(n);
+            for (int& s : c.psd_size) in >> s;
+            c.psd.assign(n, std::vector<SpillRecord>());
+        } else if (key == "CON") {
+            int n, k;
+            in >> n >> k;
+            for (int g = 0; g < k; g++) {
+                int m;
+                in >> key >> m;
+                if (key != "L+" && key != "L=") problem = "constraint cone other than L+ / L=";
+                row_kind.insert(row_kind.end(), m, key == "L=" ? '=' : '+');
+            }
+            if ((int)row_kind.size() != n) problem = "CON count differs from its cones";
+        } else if (key == "OBJACOORD") {
+            int64_t n;
+            in >> n;
+            for (int64_t t = 0; t < n && problem == nullptr; t++) {
+                int j;
+                double v;
+                in >> j >> v;
+                if (j < 0 || j >= c.mDim) problem = "OBJACOORD index out of range";
+                else c.obj[j] += v;
+            }
+        } else if (key == "ACOORD" || key == "BCOORD") {
+            bool a = key == "ACOORD";
+            int64_t n;
+            in >> n;
+            for (int64_t t = 0; t < n && problem == nullptr; t++) {
+                int i, j = -1;
+                double v;
+                in >> i;
+                if (a) in >> j;
+                in >> v;
+                if (i < 0 || i >= (int)row_kind.size() || j >= c.mDim) problem = "ACOORD/BCOORD index out of range";
+                else rows[i].push_back(a ? std::make_pair(j + 1, v) : std::make_pair(0, -v));
+            }
+        } else if (key == "HCOORD" || key == "DCOORD") {
+            bool hc = key == "HCOORD";
+            int64_t n;
+            in >> n;
+            for (int64_t t = 0; t < n && problem == nullptr; t++) {
+                SpillRecord r = {0, 0, 0, 0, 0.0};
+                int i, j = -1;
+                in >> i;
+                if (hc) in >> j;
+                in >> r.row >> r.col >> r.coef;
+                if (i < 0 || i >= (int)c.psd.size() || j >= c.mDim || r.row < r.col || r.col < 0 || r.row >= c.psd_size[i]) {
+                    problem = "HCOORD/DCOORD index out of range";
+                    break;
+                }
+                r.var_num = j + 1;
+                r.row++;
+                r.col++;
+                if (!hc) r.coef = -r.coef;
+                c.psd[i].push_back(r);
+            }
+        } else {
+            problem = "unsupported CBF section";
+        }
+        if (problem == nullptr && !in) problem = "truncated section";
     }
-    fprintf(output_file, "\n");
-    
-    // Objective coefficients (will be filled by convert_obj_stream in pass 2)
-    for (int i = 0; i < mDim-1; i++) {
-        // DEBUG
-        if (i < 5) { 
-            std::cout << "[-DEBUG WRITE-] obj_coef[" << i << "] = " << obj_coef[i] << std::endl;
+    if (problem != nullptr) {
+        std::cerr << "Error: " << path << ": " << problem << " (at " << key << ")" << std::endl;
+        return false;
+    }
+    for (std::vector<SpillRecord>& e : c.psd) coalesce_entries(e);
+    neq = 0;
+    for (auto& kv : rows) {
+        if (!canonical_row(kv.second)) continue;
+        c.rows.push_back(kv.second);
+        if (row_kind[kv.first] == '=') {
+            for (auto& p : kv.second) p.second = -p.second;
+            c.rows.push_back(kv.second);
+            neq++;
         }
-        // END DEBUG
-        fprintf(output_file, "%.15e ", obj_coef[i]);
     }
-    fprintf(output_file, "\n");
+    return true;
 }
 
-void StreamingContext::finalize_file() {
-    if (output_file != nullptr) {
-        fclose(output_file);
-        output_file = nullptr;
+// a and b agree to the precision of the SDPA text format (%15.10f, %.15e)
+static bool same_value(double a, double b) {
+    return std::fabs(a - b) <= 1e-9 * std::max(1.0, std::max(std::fabs(a), std::fabs(b)));
+}
+
+bool check_cbf_equivalence(const std::string& cbffile, const std::string& reference) {
+    CanonicalSdp cbf, sdpa;
+    int neq = 0;
+    if (!load_cbf_canonical(cbffile, cbf, neq) || !load_sdpa_canonical(reference, sdpa)) return false;
+
+    const char* problem = nullptr;
+    if (cbf.mDim != sdpa.mDim) {
+        problem = "different numbers of variables";
+    } else if (cbf.psd_size != sdpa.psd_size) {
+        problem = "different PSD block structure";
+    } else if (cbf.rows.size() != sdpa.rows.size()) {
+        problem = "different numbers of linear rows";
+    }
+    for (int i = 0; problem == nullptr && i < cbf.mDim; i++) {
+        if (!same_value(cbf.obj[i], sdpa.obj[i])) problem = "different objective";
+    }
+    for (size_t k = 0; problem == nullptr && k < cbf.psd.size(); k++) {
+        const std::vector<SpillRecord>& a = cbf.psd[k];
+        const std::vector<SpillRecord>& b = sdpa.psd[k];
+        if (a.size() != b.size()) problem = "different PSD block entries";
+        for (size_t t = 0; problem == nullptr && t < a.size(); t++) {
+            if (a[t].var_num != b[t].var_num || a[t].row != b[t].row || a[t].col != b[t].col || !same_value(a[t].coef, b[t].coef)) {
+                problem = "different PSD block entries";
+            }
+        }
+    }
+    if (problem == nullptr) {
+        // the linear rows as multisets
+        std::sort(cbf.rows.begin(), cbf.rows.end());
+        std::sort(sdpa.rows.begin(), sdpa.rows.end());
+        for (size_t t = 0; problem == nullptr && t < cbf.rows.size(); t++) {
+            const std::vector<std::pair<int, double>>& a = cbf.rows[t];
+            const std::vector<std::pair<int, double>>& b = sdpa.rows[t];
+            if (a.size() != b.size()) problem = "different linear rows";
+            for (size_t u = 0; problem == nullptr && u < a.size(); u++) {
+                if (a[u].first != b[u].first || !same_value(a[u].second, b[u].second)) problem = "different linear rows";
+            }
+        }
+    }
+    if (problem != nullptr) {
+        std::cerr << "Error: " << cbffile << " and " << reference << ": " << problem << std::endl;
+        return false;
     }
+    std::cout << cbffile << " and " << reference << " describe the same feasible set: " << cbf.psd.size()
+              << " PSD blocks, " << cbf.rows.size() - 2 * neq << " inequality rows, " << neq
+              << " equality rows (" << 2 * neq << " rows in the SDPA encoding)" << std::endl;
+    return true;
 }
 
-// Streaming functions
-void convert_obj_stream(poly_info& polyinfo, StreamingContext& ctx) {
-    // Pass 1: Register monomials, record objective coefficients
-    // Pass 2: Already have obj_coef populated, nothing to write (it's in header)
+// Monomial arithmetic used by the converters. ExponentOps is the general path
+// (exponent vectors reduced by x^2 = x and x^2 = 1); MultilinearOps is used when
+// every variable is binary, where a monomial is its set of variables and the
+// product of two monomials is the union of their sets.
+struct ExponentOps {
+    typedef MonomialKey Key;
+    static Key single(const spvec_array& sups, int i, const StreamingContext& ctx) {
+        return reduced_key(sups, i, ctx.var_flags);
+    }
+    static Key product(const spvec_array& sup1, int i1, const spvec_array& sup2, int i2, const StreamingContext& ctx) {
+        return merge_monomials(sup1, i1, sup2, i2, ctx.var_flags);
+    }
+    // entry of a moment matrix, reduced once the multiplier is applied
+    static Key entry(const spvec_array& bas, int j, int k) {
+        return merge_monomials(bas, j, bas, k, nullptr);
+    }
+    static Key product(const Key& key1, const spvec_array& sups, int i, const StreamingContext& ctx) {
+        return merge_key_with_mono(key1, sups, i, ctx.var_flags);
+    }
+    static Key square(const spvec_array& sups, int i, const StreamingContext& ctx) {
+        Key key;
+        int start = sups.pnz[0][i];
+        int nnz = sups.pnz[1][i];
+        for (int t = 0; t < nnz; t++) {
+            push_reduced(key, sups.vap[0][start + t], 2 * sups.vap[1][start + t], ctx.var_flags);
+        }
+        return key;
+    }
+};
+
+struct MultilinearOps {
+    typedef MultilinearKey Key;
+    static Key ids(const spvec_array& sups, int i) {
+        Key key;
+        int start = sups.pnz[0][i];
+        int nnz = sups.pnz[1][i];
+        if (start < 0) return key;
+        for (int t = 0; t < nnz; t++) key.push_back(sups.vap[0][start + t]);
+        key.sort_unique();
+        return key;
+    }
+    static Key single(const spvec_array& sups, int i, const StreamingContext&) {
+        return ids(sups, i);
+    }
+    static Key product(const spvec_array& sup1, int i1, const spvec_array& sup2, int i2, const StreamingContext&) {
+        return set_union(ids(sup1, i1), sup2, i2);
+    }
+    static Key entry(const spvec_array& bas, int j, int k) {
+        return set_union(ids(bas, j), bas, k);
+    }
+    static Key product(const Key& key1, const spvec_array& sups, int i, const StreamingContext&) {
+        return set_union(key1, sups, i);
+    }
+    // x^2 = x, so squaring a basis monomial leaves its variable set unchanged
+    static Key square(const spvec_array& sups, int i, const StreamingContext&) {
+        return ids(sups, i);
+    }
+    static Key set_union(const Key& key1, const spvec_array& sups, int i) {
+        int start = sups.pnz[0][i];
+        int nnz = sups.pnz[1][i];
+        if (start < 0 || nnz == 0) return key1;
+        Key key;
+        const int* a = key1.data();
+        int na = key1.size;
+        const int* b = &sups.vap[0][start];
+        // basis and polynomial supports are sorted by variable index
+        int p = 0, q = 0;
+        while (p < na && q < nnz) {
+            if (a[p] < b[q]) key.push_back(a[p++]);
+            else if (a[p] > b[q]) key.push_back(b[q++]);
+            else { key.push_back(a[p++]); q++; }
+        }
+        while (p < na) key.push_back(a[p++]);
+        while (q < nnz) key.push_back(b[q++]);
+        return key;
+    }
+};
+
+// Each converter is written once for all three modes: in the counting pass
+// lookup_monomial registers and write_entry does nothing (it buffers the block
+// for hashing with dedup_blocks), in the writing pass
+// lookup_monomial only looks up, and in single-pass mode both happen at once
+// with the entries going to the spill file.
+template <class Ops>
+static void convert_obj_impl(poly_info& polyinfo, StreamingContext& ctx) {
+    // Objective coefficients go to obj_coef (written in the header), not to entries
 
     int num_terms = polyinfo.sup.pnz_size;
     for (int i = 0; i < num_terms; i++){
-        MonomialKey key(polyinfo.sup, i); 
-
-        if (ctx.is_counting_pass) { 
-            simplify_key(key, *ctx.binvec_ptr, *ctx.Sqvec_ptr);
-            int var_num = ctx.register_monomial(key);
-        } else { 
-            // pass 2, look up var number and store coefficient
-            simplify_key(key, *ctx.binvec_ptr, *ctx.Sqvec_ptr);
-            simplify_key(key, *ctx.binvec_ptr, *ctx.Sqvec_ptr);
-            int var_num = ctx.get_var_number(key);
+        typename Ops::Key key = Ops::single(polyinfo.sup, i, ctx);
+        int var_num = ctx.lookup_monomial(key);
+
+        if (!ctx.is_counting_pass) { 
             // DEBUG
             std::cout << "[-DEBUG OBJ-] Term " << i << ": var_num=" << var_num << ", coef=" << polyinfo.coef[i][0] << ", writing to obj_coef[" << (var_num-1) << "]" << std::endl;
             // END DEBUG
+            if (ctx.single_pass && var_num > (int)ctx.obj_coef.size()) {
+                ctx.obj_coef.resize(var_num, 0.0);
+            }
             if (var_num > 0 && var_num <= ctx.obj_coef.size()) {
                 ctx.obj_coef[var_num - 1] = polyinfo.coef[i][0];
             }
@@ -252,138 +1743,96 @@ void convert_obj_stream(poly_info& polyinfo, StreamingContext& ctx) {
     }
 }
 
-void convert_eq_stream(poly_info& polyinfo, spvec_array& bassinfo, StreamingContext& ctx) {
+template <class Ops>
+static void convert_eq_impl(poly_info& polyinfo, spvec_array& bassinfo, StreamingContext& ctx) {
     int num_terms = polyinfo.sup.pnz_size;
     int bsize = bassinfo.pnz_size;
     if (bsize == 0) return;
     int sizeCone = polyinfo.sizeCone;
     int move_size = bsize + sizeCone - 1;
     
-    if (ctx.is_counting_pass) { // Pass 1: Register monomials, create block
-        // Block size: -2 * sizeCone * bsize (diagonal)
-        ctx.start_block(-2 * sizeCone * bsize);
-        
-        for (int s = 0; s < sizeCone; s++) {
-            for (int j = 0; j < bsize; j++) {
-                for (int i = 0; i < num_terms; i++) {
-                    if (fabs(polyinfo.coef[i][s]) > 1.0e-12) {
-                        MonomialKey key = merge_monomials(polyinfo.sup, i, bassinfo, j);
-                        simplify_key(key, *ctx.binvec_ptr, *ctx.Sqvec_ptr);
-                        ctx.register_monomial(key);
-                        // Same monomial appears twice (positive and negative)
-                        // but we only need to register once
-                    }
-                }
-            }
-        }
-    } else { // Pass 2: Write entries (twice - positive then negative)
-        ctx.nBlocks++;
-        
-        // First pass: positive coefficients
-        for (int s = 0; s < sizeCone; s++) {
-            for (int j = 0; j < bsize; j++) {
-                for (int i = 0; i < num_terms; i++) {
-                    double coef = polyinfo.coef[i][s];
-                    if (fabs(coef) > 1.0e-12) {
-                        MonomialKey key = merge_monomials(polyinfo.sup, i, bassinfo, j);
-                        simplify_key(key, *ctx.binvec_ptr, *ctx.Sqvec_ptr);
-                        int var_num = ctx.get_var_number(key);
-                        int pos = j + 1 + s;
-                        ctx.write_entry(var_num, ctx.nBlocks, pos, pos, coef);
+    // Block size: -2 * sizeCone * bsize (diagonal); native equalities take
+    // only the move_size rows of the positive copy
+    int off = ctx.native_eq ? ctx.begin_eq(move_size) : ctx.begin_diag(2 * sizeCone * bsize);
+    
+    // positive coefficients; the variable numbers are kept for the negated copy
+    std::vector<int> var_nums;
+    for (int s = 0; s < sizeCone; s++) {
+        for (int j = 0; j < bsize; j++) {
+            for (int i = 0; i < num_terms; i++) {
+                double coef = polyinfo.coef[i][s];
+                if (fabs(coef) > 1.0e-12) {
+                    int var_num = ctx.lookup_monomial(Ops::product(polyinfo.sup, i, bassinfo, j, ctx));
+                    if (ctx.native_eq) {
+                        ctx.write_eq(var_num, off + j + 1 + s, coef);
+                        continue;
                     }
+                    ctx.write_diag(var_num, off + j + 1 + s, coef);
+                    var_nums.push_back(var_num);
                 }
             }
         }
-        // Second pass: negated coefficients at shifted positions
-        for (int s = 0; s < sizeCone; s++) {
-            for (int j = 0; j < bsize; j++) {
-                for (int i = 0; i < num_terms; i++) {
-                    double coef = polyinfo.coef[i][s];
-                    if (fabs(coef) > 1.0e-12) {
-                        MonomialKey key = merge_monomials(polyinfo.sup, i, bassinfo, j);
-                        simplify_key(key, *ctx.binvec_ptr, *ctx.Sqvec_ptr);
-                        int var_num = ctx.get_var_number(key);
-                        int pos = j + 1 + s + move_size;
-                        ctx.write_entry(var_num, ctx.nBlocks, pos, pos, -coef);
-                    }
+    }
+    if (ctx.is_counting_pass || ctx.native_eq) return;
+    // negated coefficients at shifted positions
+    size_t t = 0;
+    for (int s = 0; s < sizeCone; s++) {
+        for (int j = 0; j < bsize; j++) {
+            for (int i = 0; i < num_terms; i++) {
+                double coef = polyinfo.coef[i][s];
+                if (fabs(coef) > 1.0e-12) {
+                    ctx.write_diag(var_nums[t++], off + j + 1 + s + move_size, -coef);
                 }
             }
         }
     }
 }
 
-void convert_ineq_a_ba1_stream(poly_info& polyinfo, spvec_array& bassinfo, StreamingContext& ctx) {
+template <class Ops>
+static void convert_ineq_a_ba1_impl(poly_info& polyinfo, spvec_array& bassinfo, StreamingContext& ctx) {
     int num_terms = polyinfo.sup.pnz_size;
     int sizeCone = polyinfo.sizeCone;
     
-    if (ctx.is_counting_pass) { // first pass: Register monomials, create block
-        ctx.start_block(-sizeCone); 
-        
-        for (int s = 0; s < sizeCone; s++) {
-            for (int i = 0; i < num_terms; i++) {
-                double coef = polyinfo.coef[i][s];
-                if (fabs(coef) > 1.0e-12) {
-                    // Merge poly term with basis[0]
-                    MonomialKey key = merge_monomials(polyinfo.sup, i, bassinfo, 0);
-                    simplify_key(key, *ctx.binvec_ptr, *ctx.Sqvec_ptr);
-                    ctx.register_monomial(key);
-                }
-            }
-        }
-    } else { // second pass: Write entries
-        ctx.nBlocks++;
-        
-        for (int s = 0; s < sizeCone; s++) {
-            for (int i = 0; i < num_terms; i++) {
-                double coef = polyinfo.coef[i][s];
-                if (fabs(coef) > 1.0e-12) {
-                    MonomialKey key = merge_monomials(polyinfo.sup, i, bassinfo, 0);
-                    simplify_key(key, *ctx.binvec_ptr, *ctx.Sqvec_ptr);
-                    int var_num = ctx.get_var_number(key);
-                    ctx.write_entry(var_num, ctx.nBlocks, s + 1, s + 1, coef);
-                }
+    int off = ctx.begin_diag(sizeCone);
+    
+    for (int s = 0; s < sizeCone; s++) {
+        for (int i = 0; i < num_terms; i++) {
+            double coef = polyinfo.coef[i][s];
+            if (fabs(coef) > 1.0e-12) {
+                // Merge poly term with basis[0]
+                int var_num = ctx.lookup_monomial(Ops::product(polyinfo.sup, i, bassinfo, 0, ctx));
+                ctx.write_diag(var_num, off + s + 1, coef);
             }
         }
-        // Remove for interior point solver (MOSEK), only uncomment for first order methods (CuLoRADS)
-        // // add trace objective for each diagonal position
-        // for (int s = 0; s < sizeCone; s++) {
-        //     ctx.write_entry(0, ctx.nBlocks, s + 1, s + 1, 1e-3);
-        // }
     }
+    // Remove for interior point solver (MOSEK), only uncomment for first order methods (CuLoRADS)
+    // // add trace objective for each diagonal position
+    // for (int s = 0; s < sizeCone; s++) {
+    //     ctx.write_entry(0, ctx.nBlocks, s + 1, s + 1, 1e-3);
+    // }
 }
 
-void convert_ineq_a_ba2_stream(poly_info& polyinfo, spvec_array& bassinfo, StreamingContext& ctx) {
+template <class Ops>
+static void convert_ineq_a_ba2_impl(poly_info& polyinfo, spvec_array& bassinfo, StreamingContext& ctx) {
     int bsize = bassinfo.pnz_size;
     int num_terms = polyinfo.sup.pnz_size;
     int sizeCone = polyinfo.sizeCone;
     
     for (int s = 0; s < sizeCone; s++) {
-        if (ctx.is_counting_pass) {
-            ctx.start_block(bsize);  // Full matrix block
-        } else {
-            ctx.nBlocks++;
-        }
+        ctx.begin_block(bsize);  // Full matrix block
         // Upper triangle of moment matrix
         for (int j = 0; j < bsize; j++) {
             for (int k = j; k < bsize; k++) {
                 // First: merge basis[j] with basis[k] to get moment matrix entry
-                MonomialKey mm_entry = merge_monomials(bassinfo, j, bassinfo, k);
+                typename Ops::Key mm_entry = Ops::entry(bassinfo, j, k);
                 
                 // Then: for each poly term, merge with mm_entry
                 for (int i = 0; i < num_terms; i++) {
                     double coef = polyinfo.coef[i][s];
                     if (fabs(coef) > 1.0e-12) {
                         // Merge poly term with moment matrix entry
-                        MonomialKey key = merge_key_with_mono(mm_entry, polyinfo.sup, i);
-                        
-                        if (ctx.is_counting_pass) {
-                            simplify_key(key, *ctx.binvec_ptr, *ctx.Sqvec_ptr);
-                            ctx.register_monomial(key);
-                        } else {
-                            simplify_key(key, *ctx.binvec_ptr, *ctx.Sqvec_ptr);
-                            int var_num = ctx.get_var_number(key);
-                            ctx.write_entry(var_num, ctx.nBlocks, j + 1, k + 1, coef);
-                        }
+                        int var_num = ctx.lookup_monomial(Ops::product(mm_entry, polyinfo.sup, i, ctx));
+                        ctx.write_entry(var_num, ctx.nBlocks, j + 1, k + 1, coef);
                     }
                 }
             }
@@ -397,68 +1846,48 @@ void convert_ineq_a_ba2_stream(poly_info& polyinfo, spvec_array& bassinfo, Strea
     }
 }
 
-void convert_sdp_stream(poly_info& polyinfo, spvec_array& bassinfo, StreamingContext& ctx) {
+template <class Ops>
+static void convert_sdp_impl(poly_info& polyinfo, spvec_array& bassinfo, StreamingContext& ctx) {
     int bsize = bassinfo.pnz_size;
     int num_terms = polyinfo.sup.pnz_size;
     int sizeCone = polyinfo.sizeCone;
     
-    if (ctx.is_counting_pass) {
-        // Pass 1: Register monomials, create block
-        ctx.start_block(bsize * sizeCone);  // Full matrix block
-        
-        // For each (j,k) in upper triangle of moment matrix
-        for (int j = 0; j < bsize; j++) {
-            for (int k = j; k < bsize; k++) {
-                MonomialKey mm_entry = merge_monomials(bassinfo, j, bassinfo, k);
-                
-                // For each poly term
-                for (int i = 0; i < num_terms; i++) {
-                    // Merge poly term with moment matrix entry
-                    MonomialKey key = merge_key_with_mono(mm_entry, polyinfo.sup, i);
-                    simplify_key(key, *ctx.binvec_ptr, *ctx.Sqvec_ptr);
-                    ctx.register_monomial(key);  // Register ONCE per (j,k,i)
-                }
-            }
-        }
-    } else {
-        // Pass 2: Write entries
-        ctx.nBlocks++;
-        
-        for (int j = 0; j < bsize; j++) {
-            int rowsize = j * sizeCone;
-            for (int k = j; k < bsize; k++) {
-                int colsize = k * sizeCone;
-                MonomialKey mm_entry = merge_monomials(bassinfo, j, bassinfo, k);
+    ctx.begin_block(bsize * sizeCone);  // Full matrix block
+    
+    // For each (j,k) in upper triangle of moment matrix
+    for (int j = 0; j < bsize; j++) {
+        int rowsize = j * sizeCone;
+        for (int k = j; k < bsize; k++) {
+            int colsize = k * sizeCone;
+            typename Ops::Key mm_entry = Ops::entry(bassinfo, j, k);
+            
+            // For each poly term: merge with moment matrix entry
+            for (int i = 0; i < num_terms; i++) {
+                int var_num = ctx.lookup_monomial(Ops::product(mm_entry, polyinfo.sup, i, ctx));
+                if (!ctx.collects_entries()) continue;
                 
-                for (int i = 0; i < num_terms; i++) {
-                    MonomialKey key = merge_key_with_mono(mm_entry, polyinfo.sup, i);
-                    simplify_key(key, *ctx.binvec_ptr, *ctx.Sqvec_ptr);
-                    int var_num = ctx.get_var_number(key);
+                // Iterate through coefficient matrix entries (CSC format)
+                int r = 0;
+                for (int s = 0; s < sizeCone; s++) {
+                    int col_end = polyinfo.mc[s + 1];
                     
-                    // Iterate through coefficient matrix entries (CSC format)
-                    int r = 0;
-                    for (int s = 0; s < sizeCone; s++) {
-                        int col_start = polyinfo.mc[s];
-                        int col_end = polyinfo.mc[s + 1];
+                    while (r < col_end) {
+                        int mr_r = polyinfo.mr[r];
+                        double coef = polyinfo.coef[r][0];
+                        
+                        // Write entry
+                        int row = mr_r + rowsize + 1;
+                        int col = s + colsize + 1;
+                        ctx.write_entry(var_num, ctx.nBlocks, row, col, coef);
                         
-                        while (r < col_end) {
-                            int mr_r = polyinfo.mr[r];
-                            double coef = polyinfo.coef[r][0];
-                            
-                            // Write entry
-                            int row = mr_r + rowsize + 1;
-                            int col = s + colsize + 1;
-                            ctx.write_entry(var_num, ctx.nBlocks, row, col, coef);
-                            
-                            // If off-diagonal in moment matrix AND off-diagonal in coef matrix
-                            if (j != k && mr_r != s) {
-                                // Write symmetric entry
-                                int sym_row = s + rowsize + 1;
-                                int sym_col = mr_r + colsize + 1;
-                                ctx.write_entry(var_num, ctx.nBlocks, sym_row, sym_col, coef);
-                            }
-                            r++;
+                        // If off-diagonal in moment matrix AND off-diagonal in coef matrix
+                        if (j != k && mr_r != s) {
+                            // Write symmetric entry
+                            int sym_row = s + rowsize + 1;
+                            int sym_col = mr_r + colsize + 1;
+                            ctx.write_entry(var_num, ctx.nBlocks, sym_row, sym_col, coef);
                         }
+                        r++;
                     }
                 }
             }
@@ -466,105 +1895,263 @@ void convert_sdp_stream(poly_info& polyinfo, spvec_array& bassinfo, StreamingCon
     }
 }
 
-void convert_ba1mmt_stream(spvec_array& bassinfo, StreamingContext& ctx) {
+template <class Ops>
+static void convert_ba1mmt_impl(spvec_array& bassinfo, StreamingContext& ctx) {
     if (bassinfo.pnz[1][0] == 0) return;
     
     // squaring monomial so double exponents
-    MonomialKey key;
-    int start = bassinfo.pnz[0][0];
-    int nnz = bassinfo.pnz[1][0];
-    for (int i = 0; i < nnz; i++) {
-        key.terms.emplace_back(bassinfo.vap[0][start + i], 2 * bassinfo.vap[1][start + i]);
-    }
-    
-    if (ctx.is_counting_pass) { // Pass 1: Register monomial, create block
-        simplify_key(key, *ctx.binvec_ptr, *ctx.Sqvec_ptr);
-        ctx.register_monomial(key);
-        ctx.start_block(-1);
-    } else { // Pass 2: Write entry
-        simplify_key(key, *ctx.binvec_ptr, *ctx.Sqvec_ptr);
-        int var_num = ctx.get_var_number(key);
-        ctx.nBlocks++;  // Track block number for this pass
-        ctx.write_entry(var_num, ctx.nBlocks, 1, 1, 1.0);
+    int var_num = ctx.lookup_monomial(Ops::square(bassinfo, 0, ctx));
+    int off = ctx.begin_diag(1);
+    ctx.write_diag(var_num, off + 1, 1.0);
 
-        // Remove for interior point solver (MOSEK), only uncomment for first order methods (CuLoRADS)
-        // // trace normalization variable contributes +1 on diag of moment blocks
-        // if (ctx.trace_norm_var_num > 0) {
-        //     ctx.write_entry(ctx.trace_norm_var_num, ctx.nBlocks, 1, 1, 1.0);
-        // }
+    // Remove for interior point solver (MOSEK), only uncomment for first order methods (CuLoRADS)
+    // // trace normalization variable contributes +1 on diag of moment blocks
+    // if (ctx.trace_norm_var_num > 0) {
+    //     ctx.write_entry(ctx.trace_norm_var_num, ctx.nBlocks, 1, 1, 1.0);
+    // }
 
-        // // add trace objective for this 1x1 moment block
-        // ctx.write_entry(0, ctx.nBlocks, 1, 1, 1e-3);
-    }
+    // // add trace objective for this 1x1 moment block
+    // ctx.write_entry(0, ctx.nBlocks, 1, 1, 1e-3);
 }
 
 // Set objective coefficient to 1e-12 for all diagonal entries of moment matrix
 // This change should help with numerical stability 
-void convert_ba2mmt_stream(spvec_array& bassinfo, StreamingContext& ctx) {
+template <class Ops>
+static void convert_ba2mmt_impl(spvec_array& bassinfo, StreamingContext& ctx) {
     int bsize = bassinfo.pnz_size;
 
-    if (ctx.is_counting_pass) {
+    if (ctx.builds_structure() && ctx.verbose) {
         std::cout << "BA2MMT:  bsize=" << bsize << ", expected_monomials=" << (bsize * (bsize + 1) / 2) << std::endl;
     }
 
-    if (ctx.is_counting_pass) { // Pass 1: Register all monomials, create block
-        ctx.start_block(bsize);  // Positive = full matrix of size bsize
-        std::unordered_set<std::string> unique_basis; 
+    ctx.begin_block(bsize);  // Positive = full matrix of size bsize
 
-        for (int i = 0; i < bsize; i++) {
-            std::string s;
-            int start = bassinfo.pnz[0][i];
-            int len = bassinfo.pnz[1][i];
-            if (start >= 0) {
-                for (int t = 0; t < len; t++) {
-                    s += std::to_string(bassinfo.vap[0][start+t]) + "^" + 
-                         std::to_string(bassinfo.vap[1][start+t]) + " ";
-                }
-            }
-            unique_basis.insert(s);
+    // Upper triangle: all pairs (i,j) where j >= i
+    for (int i = 0; i < bsize; i++) {
+        for (int j = i; j < bsize; j++) {
+            int var_num = ctx.lookup_monomial(Ops::product(bassinfo, i, bassinfo, j, ctx));
+
+            // Write constraint entry (var_num ≥ 1)
+            ctx.write_entry(var_num, ctx.nBlocks, i + 1, j + 1, 1.0);
+
+            // Remove for interior point solver (MOSEK), only uncomment for first order methods (CuLoRADS)
+            // Write objective entry for diagonal (var_num = 0)
+            // if (i == j) {
+            //     if (ctx.trace_norm_var_num > 0) { 
+            //         ctx.write_entry(ctx.trace_norm_var_num, ctx.nBlocks, i + 1, j + 1, 1.0);
+            //     }
+            //     ctx.write_entry(0, ctx.nBlocks, i+1, j+1, 1e-3);
+            // }
         }
+    }
+}
 
-        // Upper triangle: all pairs (i,j) where j >= i
-        for (int i = 0; i < bsize; i++) {
-            for (int j = i; j < bsize; j++) {
-                MonomialKey key = merge_monomials(bassinfo, i, bassinfo, j);
-                simplify_key(key, *ctx.binvec_ptr, *ctx.Sqvec_ptr);
-                ctx.register_monomial(key);
-            }
+// Streaming functions
+void convert_obj_stream(poly_info& polyinfo, StreamingContext& ctx) {
+    if (ctx.multilinear) convert_obj_impl<MultilinearOps>(polyinfo, ctx);
+    else convert_obj_impl<ExponentOps>(polyinfo, ctx);
+}
+
+void convert_eq_stream(poly_info& polyinfo, spvec_array& bassinfo, StreamingContext& ctx) {
+    if (ctx.multilinear) convert_eq_impl<MultilinearOps>(polyinfo, bassinfo, ctx);
+    else convert_eq_impl<ExponentOps>(polyinfo, bassinfo, ctx);
+}
+
+void convert_ineq_a_ba1_stream(poly_info& polyinfo, spvec_array& bassinfo, StreamingContext& ctx) {
+    if (ctx.multilinear) convert_ineq_a_ba1_impl<MultilinearOps>(polyinfo, bassinfo, ctx);
+    else convert_ineq_a_ba1_impl<ExponentOps>(polyinfo, bassinfo, ctx);
+}
+
+void convert_ineq_a_ba2_stream(poly_info& polyinfo, spvec_array& bassinfo, StreamingContext& ctx) {
+    if (ctx.multilinear) convert_ineq_a_ba2_impl<MultilinearOps>(polyinfo, bassinfo, ctx);
+    else convert_ineq_a_ba2_impl<ExponentOps>(polyinfo, bassinfo, ctx);
+}
+
+void convert_sdp_stream(poly_info& polyinfo, spvec_array& bassinfo, StreamingContext& ctx) {
+    if (ctx.multilinear) convert_sdp_impl<MultilinearOps>(polyinfo, bassinfo, ctx);
+    else convert_sdp_impl<ExponentOps>(polyinfo, bassinfo, ctx);
+}
+
+void convert_ba1mmt_stream(spvec_array& bassinfo, StreamingContext& ctx) {
+    if (ctx.multilinear) convert_ba1mmt_impl<MultilinearOps>(bassinfo, ctx);
+    else convert_ba1mmt_impl<ExponentOps>(bassinfo, ctx);
+}
+
+void convert_ba2mmt_stream(spvec_array& bassinfo, StreamingContext& ctx) {
+    if (ctx.multilinear) convert_ba2mmt_impl<MultilinearOps>(bassinfo, ctx);
+    else convert_ba2mmt_impl<ExponentOps>(bassinfo, ctx);
+}
+
+// Run the converter for item i (a constraint or moment matrix) of the block list
+static void convert_block(int i, std::vector<poly_info>& polyinfo, std::vector<spvec_array>& bassinfo, StreamingContext& ctx) {
+    if (polyinfo[i].typeCone == EQU) {
+        convert_eq_stream(polyinfo[i], bassinfo[i], ctx);
+    }
+    else if (polyinfo[i].typeCone == 0) {
+        return; 
+    }
+    else if (polyinfo[i].typeCone == INE && bassinfo[i].pnz_size == 1) {
+        convert_ineq_a_ba1_stream(polyinfo[i], bassinfo[i], ctx);
+    }
+    else if (polyinfo[i].typeCone == INE && bassinfo[i].pnz_size >= 2) {
+        convert_ineq_a_ba2_stream(polyinfo[i], bassinfo[i], ctx);
+    }
+    else if (polyinfo[i].typeCone == SDP) {
+        convert_sdp_stream(polyinfo[i], bassinfo[i], ctx);
+    }
+    else if (bassinfo[i].pnz_size == 1) {
+        convert_ba1mmt_stream(bassinfo[i], ctx);
+    }
+    else if (bassinfo[i].pnz_size >= 2) {
+        convert_ba2mmt_stream(bassinfo[i], ctx);
+    }
+}
+
+// Run the converters over every block, in file order
+static void convert_all_blocks(int msize, std::vector<poly_info>& polyinfo, std::vector<spvec_array>& bassinfo, StreamingContext& ctx) {
+    for (int i = 1; i < msize; i++) {
+        convert_block(i, polyinfo, bassinfo, ctx);
+    }
+}
+
+// Worker context for one item of the parallel conversion
+static void init_worker(StreamingContext& local, const StreamingContext& ctx) {
+    local.var_flags = ctx.var_flags;
+    local.multilinear = ctx.multilinear;
+    local.binary = ctx.binary;
+    local.pack_lp = ctx.pack_lp;
+    local.native_eq = ctx.native_eq;
+    local.coalesce = ctx.coalesce;
+    local.drop_tol = ctx.drop_tol;
+    local.dedup_blocks = ctx.dedup_blocks;
+    local.defer_dedup = true;
+    local.verbose = false;
+}
+
+// Parallel conversion (more than one OpenMP thread). Pass 1 runs each item in a
+// worker context that numbers its monomials locally; in item order the workers'
+// monomials are then registered in ctx, which gives the serial numbering. Pass 2
+// formats each item into a text buffer, looking monomials up in ctx, and the
+// buffers are written in item order, so the file matches the serial writer.
+static void stream_parallel(int msize, std::vector<poly_info>& polyinfo, std::vector<spvec_array>& bassinfo, const std::string& sdpafile, StreamingContext& ctx) {
+    std::cout << "=== Parallel conversion: " << omp_get_max_threads() << " threads ===" << std::endl;
+    convert_obj_stream(polyinfo[0], ctx);
+
+    // first block number (kept blocks), first begun block (dropped duplicates
+    // included), packed LP row and equality row of every item, from pass 1
+    std::vector<int> first_block(msize + 1, 0);
+    std::vector<int> first_raw(msize + 1, 0);
+    std::vector<int> first_lp_row(msize + 1, 0);
+    std::vector<int> first_eq_row(msize + 1, 0);
+    #pragma omp parallel for ordered schedule(dynamic, 1)
+    for (int i = 1; i < msize; i++) {
+        StreamingContext local;
+        init_worker(local, ctx);
+        convert_block(i, polyinfo, bassinfo, local);
+        local.finish_block();
+        first_raw[i] = (int)local.block_struct.size();
+        first_lp_row[i] = local.lp_rows;
+        first_eq_row[i] = local.eq_rows;
+        #pragma omp ordered
+        {
+            first_block[i] = ctx.absorb(local);
         }
-    } else { // Pass 2: write entries AND set trace objective
-        // Pass 2: write constraint entries AND objective (trace) entries
-        ctx.nBlocks++;
-        for (int i = 0; i < bsize; i++) {
-            for (int j = i; j < bsize; j++) {
-                MonomialKey key = merge_monomials(bassinfo, i, bassinfo, j);
-                simplify_key(key, *ctx.binvec_ptr, *ctx.Sqvec_ptr);
-                int var_num = ctx.get_var_number(key);
-
-                // Write constraint entry (var_num ≥ 1)
-                ctx.write_entry(var_num, ctx.nBlocks, i + 1, j + 1, 1.0);
-
-                // Remove for interior point solver (MOSEK), only uncomment for first order methods (CuLoRADS)
-                // Write objective entry for diagonal (var_num = 0)
-                // if (i == j) {
-                //     if (ctx.trace_norm_var_num > 0) { 
-                //         ctx.write_entry(ctx.trace_norm_var_num, ctx.nBlocks, i + 1, j + 1, 1.0);
-                //     }
-                //     ctx.write_entry(0, ctx.nBlocks, i+1, j+1, 1e-3);
-                // }
-            }
+    }
+    first_block[0] = 0;
+    for (int i = 1; i < msize; i++) {
+        first_block[i] += first_block[i - 1];
+        first_raw[i] += first_raw[i - 1];
+        first_lp_row[i] += first_lp_row[i - 1];
+        first_eq_row[i] += first_eq_row[i - 1];
+    }
+
+    ctx.finalize_counting();
+    ctx.output_file = fopen(sdpafile.c_str(), "w");
+    if (ctx.output_file == nullptr) {
+        std::cerr << "Error: Could not open output file " << sdpafile << std::endl;
+        return;
+    }
+    ctx.nBlocks = 0;
+    ctx.current_block = 0;
+    convert_obj_stream(polyinfo[0], ctx);
+    ctx.write_header(sdpafile);
+
+    long long total_entries = 0;
+    #pragma omp parallel for ordered schedule(dynamic, 1)
+    for (int i = 1; i < msize; i++) {
+        StreamingContext local;
+        init_worker(local, ctx);
+        local.is_counting_pass = false;
+        local.shared = &ctx;
+        local.nBlocks = first_block[i - 1];
+        local.raw_blocks = first_raw[i - 1];
+        local.lp_rows = first_lp_row[i - 1];
+        local.eq_rows = first_eq_row[i - 1];
+        std::string text;
+        local.text_out = &text;
+        convert_block(i, polyinfo, bassinfo, local);
+        local.finish_block();
+        #pragma omp ordered
+        {
+            ctx.out().put(text);
+            total_entries += local.total_entries;
+            ctx.coalesced_entries += local.coalesced_entries;
+            if (ctx.block_nnz.size() < local.block_nnz.size()) ctx.block_nnz.resize(local.block_nnz.size(), 0);
+            for (size_t b = 0; b < local.block_nnz.size(); b++) ctx.block_nnz[b] += local.block_nnz[b];
+            // chunk boundaries fall where the serial writer's begin_diag / begin_eq put them
+            ctx.spill_rows(ctx.lp_entries, ctx.lp_store, false);
+            ctx.lp_entries.insert(ctx.lp_entries.end(), local.lp_entries.begin(), local.lp_entries.end());
+            ctx.spill_rows(ctx.eq_entries, ctx.eq_store, false);
+            ctx.eq_entries.insert(ctx.eq_entries.end(), local.eq_entries.begin(), local.eq_entries.end());
         }
     }
+    ctx.total_entries += (int)total_entries;
+    ctx.lp_rows = first_lp_row[msize - 1];
+    ctx.eq_rows = first_eq_row[msize - 1];
+    ctx.flush_lp_block();
+    ctx.finalize_file();
+    std::cout << "=== Streaming complete (" << ctx.total_entries << " entries) ===" << std::endl;
 }
 
-void stream_psdp_to_file(int mdim,int msize,std::vector<poly_info>& polyinfo,std::vector<spvec_array>& bassinfo,const std::string& sdpafile,const std::vector<int>& binvec,const std::vector<int>& Sqvec) {
+// Single pass: monomials are numbered and entries spilled in one sweep; the
+// header needs mDim and the block sizes, so it is written last, followed by a
+// sequential copy of the spilled entries. Returns false if no spill file could
+// be opened (the caller falls back to two passes).
+static bool stream_single_pass(int msize, std::vector<poly_info>& polyinfo, std::vector<spvec_array>& bassinfo, const std::string& sdpafile, StreamingContext& ctx) {
+    std::string spillfile = sdpafile + ".spill";
+    ctx.spill_file = fopen(spillfile.c_str(), "w+b");
+    if (ctx.spill_file == nullptr) {
+        std::cerr << "Warning: Could not open spill file " << spillfile << ", using two passes" << std::endl;
+        return false;
+    }
+    ctx.single_pass = true;
+    ctx.is_counting_pass = false;
 
-    StreamingContext ctx;
-    ctx.is_counting_pass = true;
+    std::cout << "=== Single pass: numbering and spilling ===" << std::endl;
+    convert_obj_stream(polyinfo[0], ctx);
+    convert_all_blocks(msize, polyinfo, bassinfo, ctx);
+    ctx.close_lp_block();
+    ctx.flush_lp_block();
+    ctx.obj_coef.resize(ctx.mDim + 1, 0.0);
 
-    ctx.binvec_ptr = &binvec;
-    ctx.Sqvec_ptr = &Sqvec;
-    
+    ctx.output_file = fopen(sdpafile.c_str(), "w");
+    if (ctx.output_file == nullptr) {
+        std::cerr << "Error: Could not open output file " << sdpafile << std::endl;
+    } else {
+        ctx.write_header(sdpafile);
+        ctx.copy_spill();
+    }
+    fclose(ctx.spill_file);
+    ctx.spill_file = nullptr;
+    remove(spillfile.c_str());
+    ctx.finalize_file();
+    std::cout << "=== Streaming complete (" << ctx.total_entries << " entries) ===" << std::endl;
+    return true;
+}
+
+// Serial two passes: pass 1 numbers the monomials and records the block
+// structure, pass 2 writes the header and the entries
+static void stream_two_pass(int msize, std::vector<poly_info>& polyinfo, std::vector<spvec_array>& bassinfo, const std::string& sdpafile, StreamingContext& ctx) {
     std::cout << "=== Pass 1: Counting ===" << std::endl;
     
     // --- PASS 1: Count monomials, build structure ---
@@ -572,38 +2159,7 @@ void stream_psdp_to_file(int mdim,int msize,std::vector<poly_info>& polyinfo,std
     
     std::cout << "After convert_obj_stream:       (polyinfo.size=" << polyinfo.size() << ", msize=" << msize << ", bassinfo.size=" << bassinfo.size() << ")" << std::endl;
     
-    for (int i = 1; i < msize; i++) {
-        int before = ctx.mDim; 
-        
-        if (polyinfo[i].typeCone == EQU) {
-            convert_eq_stream(polyinfo[i], bassinfo[i], ctx);
-            // std::cout << "EQU[" << i << "] added " << (ctx.mDim - before) << " monomials" << std::endl;
-        }
-        else if (polyinfo[i].typeCone == 0) {
-            continue;
-        }
-        else if (polyinfo[i].typeCone == INE && bassinfo[i].pnz_size == 1) {
-            convert_ineq_a_ba1_stream(polyinfo[i], bassinfo[i], ctx);
-            // std::cout << "INE_BA1[" << i << "] added " << (ctx.mDim - before) << " monomials" << std::endl;
-        }
-        else if (polyinfo[i].typeCone == INE && bassinfo[i].pnz_size >= 2) {
-            convert_ineq_a_ba2_stream(polyinfo[i], bassinfo[i], ctx);
-            // std::cout << "INE_BA2[" << i << "] added " << (ctx.mDim - before) << " monomials" << std::endl;
-        }
-        else if (polyinfo[i].typeCone == SDP) {
-            convert_sdp_stream(polyinfo[i], bassinfo[i], ctx);
-            // std::cout << "SDP[" << i << "] added " << (ctx.mDim - before) << " monomials" << std::endl;
-        }
-        else if (bassinfo[i].pnz_size == 1) {
-            convert_ba1mmt_stream(bassinfo[i], ctx);
-            // std::cout << "BA1MMT[" << i << "] added " << (ctx.mDim - before) << " monomials" << std::endl;
-        }
-        else if (bassinfo[i].pnz_size >= 2) {
-            convert_ba2mmt_stream(bassinfo[i], ctx);
-            // std::cout << "BA2MMT[" << i << "] added " << (ctx.mDim - before) << " monomials" << std::endl;
-        }
-    }
-
+    convert_all_blocks(msize, polyinfo, bassinfo, ctx);
     
     // prepare for pass 2
     ctx.finalize_counting();
@@ -631,34 +2187,85 @@ void stream_psdp_to_file(int mdim,int msize,std::vector<poly_info>& polyinfo,std
     // Write header after objective (so we have obj_coef populated)
     ctx.write_header(sdpafile);
     
-    for (int i = 1; i < msize; i++) {
-        if (polyinfo[i].typeCone == EQU) {
-            convert_eq_stream(polyinfo[i], bassinfo[i], ctx);
-        }
-        else if (polyinfo[i].typeCone == 0) {
-            continue; 
-        }
-        else if (polyinfo[i].typeCone == INE && bassinfo[i].pnz_size == 1) {
-            convert_ineq_a_ba1_stream(polyinfo[i], bassinfo[i], ctx);
-        }
-        else if (polyinfo[i].typeCone == INE && bassinfo[i].pnz_size >= 2) {
-            convert_ineq_a_ba2_stream(polyinfo[i], bassinfo[i], ctx);
-        }
-        else if (polyinfo[i].typeCone == SDP) {
-            convert_sdp_stream(polyinfo[i], bassinfo[i], ctx);
-        }
-        else if (bassinfo[i].pnz_size == 1) {
-            convert_ba1mmt_stream(bassinfo[i], ctx);
-        }
-        else if (bassinfo[i].pnz_size >= 2) {
-            convert_ba2mmt_stream(bassinfo[i], ctx);
-        }
-    }
+    convert_all_blocks(msize, polyinfo, bassinfo, ctx);
+    ctx.flush_lp_block();
     
     ctx.finalize_file();
     std::cout << "=== Streaming complete ===" << std::endl;
 }
 
+// Write the SDP blocks of ctx's format to sdpafile: in parallel on several
+// threads, else in a single pass or, failing that, in two passes
+static void stream_conic(int msize, std::vector<poly_info>& polyinfo, std::vector<spvec_array>& bassinfo, const std::string& sdpafile, StreamingContext& ctx, bool single_pass) {
+    if (ctx.monomial_budget > 0) {
+        // out-of-core numbering needs every monomial before pass 2
+        stream_two_pass(msize, polyinfo, bassinfo, sdpafile, ctx);
+        return;
+    }
+    if (omp_get_max_threads() > 1 && msize > 2) {
+        stream_parallel(msize, polyinfo, bassinfo, sdpafile, ctx);
+        return;
+    }
+    if (single_pass && stream_single_pass(msize, polyinfo, bassinfo, sdpafile, ctx)) {
+        return;
+    }
+    stream_two_pass(msize, polyinfo, bassinfo, sdpafile, ctx);
+}
+
+void stream_psdp_to_file(int mdim,int msize,std::vector<poly_info>& polyinfo,std::vector<spvec_array>& bassinfo,const std::string& sdpafile,const VarFlags* var_flags,bool single_pass,SdpFormat format,size_t monomial_budget) {
+
+    StreamingContext ctx;
+    ctx.is_counting_pass = true;
+    ctx.binary = format == SDP_BINARY;
+    ctx.pack_lp = true;
+    ctx.coalesce = true;
+    ctx.dedup_blocks = true;
+
+    ctx.var_flags = var_flags;
+
+    // All-binary problem: monomials are variable sets, products are set unions
+    ctx.multilinear = var_flags != nullptr && var_flags->size() == mdim && var_flags->allBinary();
+    if (ctx.multilinear) {
+        std::cout << "Multilinear mode: all " << mdim << " variables are binary" << std::endl;
+    }
+
+    if (monomial_budget > 0) {
+        if (ctx.monomial_index.open(sdpafile + ".monomials")) {
+            ctx.monomial_budget = monomial_budget;
+            // duplicate-block elimination compares blocks under the final
+            // numbers in pass 1; in this mode those exist only after the
+            // merge, so it is disabled
+            ctx.dedup_blocks = false;
+            std::cout << "Out-of-core monomial numbering, budget " << metrics::human_bytes(monomial_budget)
+                      << " (duplicate-block elimination disabled)" << std::endl;
+        } else {
+            std::cerr << "Warning: numbering the monomials in memory" << std::endl;
+        }
+    }
+
+    if (format == SDP_CBF) {
+        // the conic part goes through a temporary .sdpb container; the
+        // equalities stay rows and are added when the CBF file is written
+        std::string conicfile = sdpafile + ".sdpb.tmp";
+        ctx.binary = true;
+        ctx.native_eq = true;
+        stream_conic(msize, polyinfo, bassinfo, conicfile, ctx, single_pass);
+        write_cbf(conicfile, ctx, sdpafile);
+        remove(conicfile.c_str());
+    } else {
+        stream_conic(msize, polyinfo, bassinfo, sdpafile, ctx, single_pass);
+    }
+    std::cout << "Coalesced entries: " << ctx.coalesced_entries << " duplicate or |coef| < " << ctx.drop_tol
+              << " entries removed, " << ctx.total_entries << " written" << std::endl;
+    ctx.monomial_index.close();
+    if (ctx.dedup_blocks) {
+        std::cout << "Duplicate blocks: " << ctx.duplicate_blocks << " removed (" << ctx.duplicate_entries
+                  << " entries)" << std::endl;
+    } else {
+        std::cout << "Duplicate blocks: not checked (out-of-core numbering)" << std::endl;
+    }
+}
+
 // Simple test function - call from main to verify streaming code compiles/works
 void test_streaming_basics() {
     std::cout << "\n=== Testing Streaming Basics ===" << std::endl;
@@ -666,11 +2273,10 @@ void test_streaming_basics() {
     StreamingContext ctx;
     
     // Test 1: MonomialKey hashing
-    MonomialKey m1, m2, m3, m4;
-    m1.terms = {{1, 2}, {3, 1}};  // x1^2 * x3
-    m2.terms = {{2, 1}};          // x2
-    m3.terms = {{1, 2}, {3, 1}};  // same as m1
-    m4.terms = {{1,2}, {3,1}, {2,1}}; 
+    MonomialKey m1 = {{1, 2}, {3, 1}};  // x1^2 * x3
+    MonomialKey m2 = {{2, 1}};          // x2
+    MonomialKey m3 = {{1, 2}, {3, 1}};  // same as m1
+    MonomialKey m4 = {{1,2}, {3,1}, {2,1}}; 
     
     int v1 = ctx.register_monomial(m1);
     int v2 = ctx.register_monomial(m2);
@@ -874,6 +2480,150 @@ system("cat /tmp/test_eq.sdpa");
 
 poly3.sup.del();
 basis5.del();
+
+// Test 8: serial and parallel writers produce the same file
+std::cout << "\n--- Testing serial vs parallel output ---" << std::endl;
+
+// item 1: moment matrix over {1, x1..x5}; items 2 and 3: the same localizing
+// block of 0.1*x6 + 0.2*x6 + 0.3*x6 + x7 over {1, x1..x5, x8}, so every entry
+// sums three duplicates and item 3 is a duplicate block
+auto fill = [](spvec_array& a, const std::vector<std::vector<std::pair<int, int>>>& monos) {
+    int nt = 0;
+    for (const auto& m : monos) nt += (int)m.size();
+    a.alloc((int)monos.size(), std::max(nt, 1));
+    int vp = 0;
+    for (int i = 0; i < (int)monos.size(); i++) {
+        a.pnz[0][i] = monos[i].empty() ? -1 : vp;
+        a.pnz[1][i] = (int)monos[i].size();
+        for (const auto& t : monos[i]) { a.vap[0][vp] = t.first; a.vap[1][vp] = t.second; vp++; }
+    }
+    a.pnz_size = (int)monos.size();
+    a.vap_size = vp;
+};
+std::vector<poly_info> pis(4);
+std::vector<spvec_array> bas(4);
+pis[0].typeCone = 1;
+pis[0].sizeCone = 1;
+fill(pis[0].sup, {{{1, 1}}, {{2, 1}, {3, 1}}});
+pis[0].coef = {{1.0}, {-1.0}};
+fill(bas[0], {{}});
+pis[1].typeCone = 2;
+pis[1].sizeCone = 1;
+fill(pis[1].sup, {{}});
+pis[1].coef = {{1.0}};
+fill(bas[1], {{}, {{1, 1}}, {{2, 1}}, {{3, 1}}, {{4, 1}}, {{5, 1}}});
+for (int i = 2; i < 4; i++) {
+    pis[i].typeCone = INE;
+    pis[i].sizeCone = 1;
+    fill(pis[i].sup, {{{6, 1}}, {{6, 1}}, {{6, 1}}, {{7, 1}}});
+    pis[i].coef = {{0.1}, {0.2}, {0.3}, {1.0}};
+    fill(bas[i], {{}, {{1, 1}}, {{2, 1}}, {{3, 1}}, {{4, 1}}, {{5, 1}}, {{8, 1}}});
+}
+
+// file contents without the "* File name = ..." header line
+auto slurp = [](const char* path) {
+    std::ifstream in(path, std::ios::binary);
+    std::string all, line;
+    while (std::getline(in, line)) {
+        if (line.rfind("* File name", 0) != 0) all += line + "\n";
+    }
+    return all;
+};
+int threads = omp_get_max_threads();
+omp_set_num_threads(1);
+stream_psdp_to_file(9, 4, pis, bas, "/tmp/test_serial.sdpa", nullptr, true);
+stream_psdp_to_file(9, 4, pis, bas, "/tmp/test_two_pass.sdpa", nullptr, false);
+omp_set_num_threads(std::max(threads, 4));
+stream_psdp_to_file(9, 4, pis, bas, "/tmp/test_parallel.sdpa", nullptr, true);
+omp_set_num_threads(threads);
+std::string serial = slurp("/tmp/test_serial.sdpa");
+if (serial.empty() || serial != slurp("/tmp/test_two_pass.sdpa") || serial != slurp("/tmp/test_parallel.sdpa")) {
+    std::cerr << "Error: serial, two-pass and parallel SDPA files differ" << std::endl;
+    exit(EXIT_FAILURE);
+}
+std::cout << "Serial, two-pass and parallel files are byte-identical (but for the file name)" << std::endl;
+for (int i = 0; i < 4; i++) {
+    pis[i].sup.del();
+    bas[i].del();
+}
     
     std::cout << "=== Streaming Test PASSED ===" << std::endl;
-}
\ No newline at end of file
+}
+// The monomial key and map used before FlatMonomialMap, kept for bench_monomial_map
+namespace {
+struct LegacyKey {
+    std::vector<std::pair<int, int>> terms;
+    bool operator==(const LegacyKey& other) const { return terms == other.terms; }
+};
+struct LegacyKeyHash {
+    size_t operator()(const LegacyKey& key) const {
+        size_t h = 0;
+        for (const auto& [var, exp] : key.terms) {
+            h ^= std::hash<int>()(var) + 0x9e3779b9 + (h << 6) + (h >> 2);
+            h ^= std::hash<int>()(exp) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        }
+        return h;
+    }
+};
+}
+
+// Pass-1 style workload: num_keys products of two random basis monomials over
+// num_vars variables are built and registered, once with the vector key in a
+// std::unordered_map and once with MonomialKey in a FlatMonomialMap.
+void bench_monomial_map(int num_vars, int num_keys) {
+    std::cout << "\n=== Monomial map benchmark: " << num_keys << " products over " << num_vars << " variables ===" << std::endl;
+    std::mt19937 rng(12345);
+    int bsize = 4096;
+    spvec_array basis;
+    basis.alloc(bsize, 3 * bsize);
+    int vp = 0;
+    for (int i = 0; i < bsize; i++) {
+        int d = 1 + (int)(rng() % 3);
+        std::vector<int> vs;
+        while ((int)vs.size() < d) {
+            int v = (int)(rng() % num_vars);
+            if (std::find(vs.begin(), vs.end(), v) == vs.end()) vs.push_back(v);
+        }
+        std::sort(vs.begin(), vs.end());
+        basis.pnz[0][i] = vp;
+        basis.pnz[1][i] = d;
+        for (int v : vs) { basis.vap[0][vp] = v; basis.vap[1][vp] = 1 + (int)(rng() % 2); vp++; }
+    }
+    basis.pnz_size = bsize;
+    basis.vap_size = vp;
+    std::vector<std::pair<int, int>> pairs(num_keys);
+    for (auto& p : pairs) p = std::make_pair((int)(rng() % bsize), (int)(rng() % bsize));
+
+    // legacy: vector key, hashed term by term on each lookup, node-based map
+    double t0 = metrics::wall_seconds();
+    int legacy_dim = 1;
+    {
+        std::unordered_map<LegacyKey, int, LegacyKeyHash> map;
+        for (const auto& p : pairs) {
+            MonomialKey k = merge_monomials(basis, p.first, basis, p.second, nullptr);
+            LegacyKey key;
+            for (int t = 0; t < k.size; t++) key.terms.emplace_back(k.var(t), k.exp(t));
+            auto it = map.find(key);
+            if (it == map.end()) map[key] = legacy_dim++;
+        }
+        double t1 = metrics::wall_seconds();
+        // nodes (next pointer, key, value, cached hash; 16-byte malloc granularity),
+        // the term vectors of the keys and the bucket array
+        size_t node = (sizeof(void*) + sizeof(std::pair<const LegacyKey, int>) + sizeof(size_t) + 15) / 16 * 16;
+        size_t bytes = map.size() * node + map.bucket_count() * sizeof(void*);
+        for (const auto& e : map) bytes += (e.first.terms.capacity() * sizeof(std::pair<int, int>) + 15) / 16 * 16;
+        printf("  unordered_map + vector key  : %8.3f s, %d monomials, map holds ~%s\n",
+               t1 - t0, legacy_dim - 1, metrics::human_bytes(bytes).c_str());
+    }
+
+    // current: inline key with cached hash, open-addressing map
+    t0 = metrics::wall_seconds();
+    StreamingContext ctx;
+    for (const auto& p : pairs) {
+        ctx.register_monomial(merge_monomials(basis, p.first, basis, p.second, nullptr));
+    }
+    double t1 = metrics::wall_seconds();
+    printf("  FlatMonomialMap + inline key: %8.3f s, %d monomials, map holds %s\n",
+           t1 - t0, ctx.mDim - 1, metrics::human_bytes(ctx.monomial_to_var.memory_bytes()).c_str());
+    basis.del();
+}